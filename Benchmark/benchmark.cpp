@@ -0,0 +1,249 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// A single sample should take at least this long so timer resolution does not dominate (microseconds).
+static const double MINIMUM_SAMPLE_TIME = 200.0;
+
+// Untimed samples run before measuring so caches, allocators and worker threads are warm.
+static const unsigned int WARMUP_SAMPLES = 5;
+
+static double Percentile(const std::vector<double>& sorted_samples, double percentile)
+{
+	// Nearest rank percentile.
+	size_t rank = static_cast<size_t>(percentile / 100.0 * static_cast<double>(sorted_samples.size()) + 0.5);
+	rank = (std::max)(rank, static_cast<size_t>(1));
+	rank = (std::min)(rank, sorted_samples.size());
+	return sorted_samples[rank - 1];
+}
+
+static double Metric(const BenchmarkResult& result, const std::string& metric)
+{
+	if (metric == "p95")
+		return result.p95;
+
+	if (metric == "p99")
+		return result.p99;
+
+	return result.p50;
+}
+
+static bool ReadNumber(const std::string& object, const char* key, double& value)
+{
+	// Find "key": and parse the number after it.
+	std::string pattern = std::string("\"") + key + "\":";
+	size_t position = object.find(pattern);
+	if (position == std::string::npos)
+		return false;
+
+	value = strtod(object.c_str() + position + pattern.size(), 0);
+	return true;
+}
+
+Benchmark::Benchmark()
+{
+}
+
+Benchmark::Benchmark(const Benchmark& kOther)
+{
+}
+
+Benchmark::~Benchmark()
+{
+}
+
+void Benchmark::Add(const char* name, const Setup& setup)
+{
+	Case benchmark_case;
+	benchmark_case.name = name;
+	benchmark_case.setup = setup;
+	cases_.push_back(benchmark_case);
+}
+
+void Benchmark::Run(const std::string& filter, unsigned int samples, std::vector<BenchmarkResult>& results)
+{
+	printf("%-32s %10s %12s %12s %12s %12s\n", "case", "iterations", "mean (us)", "p50 (us)", "p95 (us)", "p99 (us)");
+
+	for (const Case& benchmark_case : cases_)
+	{
+		if (benchmark_case.name.find(filter) == std::string::npos)
+			continue;
+
+		BenchmarkResult result;
+		if (!RunCase(benchmark_case, samples, result))
+		{
+			printf("%-32s skipped\n", benchmark_case.name.c_str());
+			continue;
+		}
+
+		printf("%-32s %10u %12.3f %12.3f %12.3f %12.3f\n", result.name.c_str(), result.iterations, result.mean, result.p50, result.p95, result.p99);
+		results.push_back(result);
+	}
+}
+
+void Benchmark::List()
+{
+	for (const Case& benchmark_case : cases_)
+		printf("%s\n", benchmark_case.name.c_str());
+}
+
+bool Benchmark::WriteResults(const char* path, const std::vector<BenchmarkResult>& results)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+		return false;
+
+	// One object per case, written one per line so the reader can stay trivial.
+	file << "{\n\t\"version\":" << BENCHMARK_RESULTS_VERSION << ",\n\t\"unit\":\"microseconds\",\n\t\"results\":[\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		file << "\t\t{\"name\":\"" << result.name << "\",\"samples\":" << result.samples << ",\"iterations\":" << result.iterations
+			<< ",\"mean\":" << result.mean << ",\"min\":" << result.minimum << ",\"p50\":" << result.p50
+			<< ",\"p95\":" << result.p95 << ",\"p99\":" << result.p99 << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	file << "\t]\n}\n";
+
+	return file.good();
+}
+
+bool Benchmark::ReadResults(const char* path, std::vector<BenchmarkResult>& results)
+{
+	std::ifstream file(path);
+	if (!file)
+		return false;
+
+	std::stringstream contents;
+	contents << file.rdbuf();
+	std::string text = contents.str();
+
+	// Check the file was written by a compatible version.
+	double version = 0.0;
+	if (!ReadNumber(text, "version", version) || static_cast<unsigned int>(version) != BENCHMARK_RESULTS_VERSION)
+		return false;
+
+	// Walk the result objects.
+	const std::string name_key = "{\"name\":\"";
+	size_t position = text.find(name_key);
+	while (position != std::string::npos)
+	{
+		size_t name_start = position + name_key.size();
+		size_t name_end = text.find('"', name_start);
+		size_t object_end = text.find('}', name_start);
+		if (name_end == std::string::npos || object_end == std::string::npos)
+			return false;
+
+		std::string object = text.substr(position, object_end - position);
+
+		BenchmarkResult result;
+		result.name = text.substr(name_start, name_end - name_start);
+
+		double samples = 0.0, iterations = 0.0;
+		if (!ReadNumber(object, "samples", samples) || !ReadNumber(object, "iterations", iterations) ||
+			!ReadNumber(object, "mean", result.mean) || !ReadNumber(object, "min", result.minimum) ||
+			!ReadNumber(object, "p50", result.p50) || !ReadNumber(object, "p95", result.p95) || !ReadNumber(object, "p99", result.p99))
+			return false;
+
+		result.samples = static_cast<unsigned int>(samples);
+		result.iterations = static_cast<unsigned int>(iterations);
+		results.push_back(result);
+
+		position = text.find(name_key, object_end);
+	}
+
+	return true;
+}
+
+bool Benchmark::Compare(const std::vector<BenchmarkResult>& baseline, const std::vector<BenchmarkResult>& results, const std::string& metric, double threshold)
+{
+	bool passed = true;
+
+	printf("\n%-32s %12s %12s %9s  (%s, threshold %.1f%%)\n", "case", "baseline", "current", "change", metric.c_str(), threshold);
+	for (const BenchmarkResult& result : results)
+	{
+		// Cases missing from the baseline are new and cannot regress.
+		std::vector<BenchmarkResult>::const_iterator base = std::find_if(baseline.begin(), baseline.end(),
+			[&result](const BenchmarkResult& candidate) { return candidate.name == result.name; });
+		if (base == baseline.end())
+		{
+			printf("%-32s %12s %12.3f %9s\n", result.name.c_str(), "-", Metric(result, metric), "new");
+			continue;
+		}
+
+		double before = Metric(*base, metric);
+		double after = Metric(result, metric);
+		double change = before > 0.0 ? (after - before) / before * 100.0 : 0.0;
+		bool regressed = change > threshold;
+		if (regressed)
+			passed = false;
+
+		printf("%-32s %12.3f %12.3f %8.1f%%%s\n", result.name.c_str(), before, after, change, regressed ? "  REGRESSION" : "");
+	}
+
+	// A baseline case that did not run this time (its setup failed, or it was removed) fails the comparison, or a broken
+	// case would drop out of the gate unnoticed.
+	for (const BenchmarkResult& base : baseline)
+	{
+		std::vector<BenchmarkResult>::const_iterator result = std::find_if(results.begin(), results.end(),
+			[&base](const BenchmarkResult& candidate) { return candidate.name == base.name; });
+		if (result != results.end())
+			continue;
+
+		printf("%-32s %12.3f %12s %9s  MISSING\n", base.name.c_str(), Metric(base, metric), "-", "-");
+		passed = false;
+	}
+
+	return passed;
+}
+
+bool Benchmark::RunCase(const Case& benchmark_case, unsigned int samples, BenchmarkResult& result)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Build the case's state.
+	std::function<void()> run = benchmark_case.setup();
+	if (!run)
+		return false;
+
+	// Time a single call to decide how many calls each sample needs to be measurable.
+	Clock::time_point start = Clock::now();
+	run();
+	double single = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	unsigned int iterations = single >= MINIMUM_SAMPLE_TIME ? 1 : static_cast<unsigned int>(MINIMUM_SAMPLE_TIME / (std::max)(single, 0.01)) + 1;
+
+	for (unsigned int i = 0; i < WARMUP_SAMPLES * iterations; i++)
+		run();
+
+	// Take the samples.
+	std::vector<double> timings(samples);
+	for (unsigned int sample = 0; sample < samples; sample++)
+	{
+		start = Clock::now();
+		for (unsigned int i = 0; i < iterations; i++)
+			run();
+
+		timings[sample] = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+	}
+
+	// Summarize.
+	std::sort(timings.begin(), timings.end());
+	double total = 0.0;
+	for (double timing : timings)
+		total += timing;
+
+	result.name = benchmark_case.name;
+	result.samples = samples;
+	result.iterations = iterations;
+	result.mean = total / samples;
+	result.minimum = timings.front();
+	result.p50 = Percentile(timings, 50.0);
+	result.p95 = Percentile(timings, 95.0);
+	result.p99 = Percentile(timings, 99.0);
+
+	return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Bumped whenever the layout of the results file changes.
+const unsigned int BENCHMARK_RESULTS_VERSION = 1;
+
+struct BenchmarkResult
+{
+	std::string name;
+	unsigned int samples;
+	unsigned int iterations;	// Calls timed together in each sample.
+	double mean;				// All timings are microseconds per call.
+	double minimum;
+	double p50;
+	double p95;
+	double p99;
+};
+
+class Benchmark
+{
+public:
+	// Builds a case's state and returns the function to time, or an empty function when the case cannot run here.
+	typedef std::function<std::function<void()>()> Setup;
+
+	Benchmark();
+	Benchmark(const Benchmark&);
+	~Benchmark();
+
+	// Register a case. Setup only runs when the case is selected.
+	void Add(const char*, const Setup&);
+
+	// Run every case whose name contains the filter, taking the given number of samples of each.
+	void Run(const std::string&, unsigned int, std::vector<BenchmarkResult>&);
+	void List();
+
+	static bool WriteResults(const char*, const std::vector<BenchmarkResult>&);
+	static bool ReadResults(const char*, std::vector<BenchmarkResult>&);
+
+	// Compare results against a baseline using the named percentile (p50, p95 or p99).
+	// Returns false when any case is slower than the baseline by more than the threshold (percent), or when a baseline
+	// case is missing from the results.
+	static bool Compare(const std::vector<BenchmarkResult>&, const std::vector<BenchmarkResult>&, const std::string&, double);
+
+private:
+	struct Case
+	{
+		std::string name;
+		Setup setup;
+	};
+
+	bool RunCase(const Case&, unsigned int, BenchmarkResult&);
+
+private:
+	std::vector<Case> cases_;
+};
+
+// Register the engine's hot path cases.
+class JobSystem;
+class Direct3D;
+void RegisterEngineBenchmarks(Benchmark&, JobSystem*, Direct3D*);
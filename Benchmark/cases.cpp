@@ -0,0 +1,694 @@
+#include "benchmark.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "system.h"
+#include "animation.h"
+#include "batchMath.h"
+#include "broadphase.h"
+#include "font.h"
+#include "jobSystem.h"
+#include "lightClusters.h"
+#include "meshLod.h"
+#include "poolAllocator.h"
+#include "sceneFile.h"
+#include "spriteBatch.h"
+#include "task.h"
+#include "textureAtlas.h"
+
+// Joints in the synthetic skeleton used by the animation cases.
+static const unsigned int BENCHMARK_JOINTS = 64;
+
+// Characters animated by the animation update case; a crowd scene.
+static const unsigned int BENCHMARK_CHARACTERS = 256;
+
+// Boxes moved and paired by the broadphase case.
+static const unsigned int BENCHMARK_PROXIES = 4096;
+
+// Transforms run through the batch math cases; roughly the objects a culling pass sees.
+static const unsigned int BENCHMARK_TRANSFORMS = 4096;
+
+// Entities in the scene file loaded by the scene load case; a large level.
+static const unsigned int BENCHMARK_SCENE_ENTITIES = 65536;
+static const char BENCHMARK_SCENE_PATH[] = "benchmark.scene";
+
+// Blocks allocated and freed by the pool case, and depth of the task chain case.
+static const unsigned int BENCHMARK_POOL_BLOCKS = 4096;
+static const unsigned int BENCHMARK_TASK_DEPTH = 64;
+
+// Dynamic lights assigned to clusters by the light assignment case, half point and half spot.
+static const unsigned int BENCHMARK_LIGHTS = 512;
+
+// Quads submitted by the sprite batch case; a busy HUD with debug overlays.
+static const unsigned int BENCHMARK_SPRITES = 8192;
+
+// Size of the sprite batch case's glyph atlas; room for printable ASCII at 16 pixels with space to spare.
+static const unsigned int BENCHMARK_GLYPH_ATLAS_SIZE = 256;
+
+// Rings of the sphere simplified by the mesh LOD cases; 64 rings is about 16k triangles.
+static const int BENCHMARK_SPHERE_RINGS = 64;
+
+// Structure of arrays storage for the batch math cases: one array per float component.
+struct BatchArrays
+{
+	std::vector<float> components[16];
+
+	BatchArrays(unsigned int component_count, unsigned int count)
+	{
+		for (unsigned int component = 0; component < component_count; component++)
+			components[component].resize(count);
+	}
+
+	MatrixSoA Matrices()
+	{
+		MatrixSoA matrices;
+		for (int element = 0; element < 16; element++)
+			matrices.m[element] = components[element].data();
+		return matrices;
+	}
+
+	Float3SoA Float3(int first)
+	{
+		Float3SoA values = { components[first].data(), components[first + 1].data(), components[first + 2].data() };
+		return values;
+	}
+
+	BoxSoA Boxes()
+	{
+		BoxSoA boxes = { Float3(0), Float3(3) };
+		return boxes;
+	}
+};
+
+// Fill a matrix stream with world matrices like the ones matrix_multiply uses.
+static void BuildTestWorlds(BatchArrays& arrays, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixMultiply(XMMatrixRotationY(i * 0.01f), XMMatrixTranslation(static_cast<float>(i), 0.0f, 10.0f)));
+		for (int element = 0; element < 16; element++)
+			arrays.components[element][i] = (&world._11)[element];
+	}
+}
+
+// Build a closed sphere from rings of quads with a single vertex at each pole.
+static void BuildTestSphere(std::vector<XMFLOAT3>& positions, std::vector<unsigned int>& indices)
+{
+	const int kRings = BENCHMARK_SPHERE_RINGS;
+	const int kSegments = BENCHMARK_SPHERE_RINGS * 2;
+
+	positions.push_back(XMFLOAT3(0.0f, 1.0f, 0.0f));
+	for (int ring = 1; ring < kRings; ring++)
+	{
+		float theta = XM_PI * ring / kRings;
+		for (int segment = 0; segment < kSegments; segment++)
+		{
+			float phi = XM_2PI * segment / kSegments;
+			positions.push_back(XMFLOAT3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)));
+		}
+	}
+	positions.push_back(XMFLOAT3(0.0f, -1.0f, 0.0f));
+
+	auto vertex = [&positions, kRings, kSegments](int ring, int segment)
+	{
+		if (ring == 0)
+			return 0u;
+		if (ring == kRings)
+			return static_cast<unsigned int>(positions.size() - 1);
+		return static_cast<unsigned int>(1 + (ring - 1) * kSegments + segment % kSegments);
+	};
+
+	for (int ring = 0; ring < kRings; ring++)
+	{
+		for (int segment = 0; segment < kSegments; segment++)
+		{
+			unsigned int a = vertex(ring, segment), b = vertex(ring, segment + 1);
+			unsigned int c = vertex(ring + 1, segment), d = vertex(ring + 1, segment + 1);
+			if (ring != 0)
+				indices.insert(indices.end(), { a, b, c });
+			if (ring != kRings - 1)
+				indices.insert(indices.end(), { b, d, c });
+		}
+	}
+}
+
+// Build a chain skeleton and a looping clip with every joint swinging out of phase with its parent.
+static void BuildTestAnimation(Skeleton& skeleton, AnimationClip& clip, float speed)
+{
+	const unsigned int kFrames = 60;
+
+	skeleton.parents.resize(BENCHMARK_JOINTS);
+	skeleton.inverse_bind_matrices.resize(BENCHMARK_JOINTS);
+	for (unsigned int joint = 0; joint < BENCHMARK_JOINTS; joint++)
+	{
+		skeleton.parents[joint] = static_cast<int>(joint) - 1;
+		XMStoreFloat4x4(&skeleton.inverse_bind_matrices[joint], XMMatrixTranslation(0.0f, -0.1f * joint, 0.0f));
+	}
+
+	std::vector<XMFLOAT4> rotations(kFrames * BENCHMARK_JOINTS);
+	std::vector<XMFLOAT3> translations(kFrames * BENCHMARK_JOINTS);
+	std::vector<XMFLOAT3> scales(kFrames * BENCHMARK_JOINTS, XMFLOAT3(1.0f, 1.0f, 1.0f));
+	for (unsigned int frame = 0; frame < kFrames; frame++)
+	{
+		for (unsigned int joint = 0; joint < BENCHMARK_JOINTS; joint++)
+		{
+			float angle = sinf(frame * speed * XM_2PI / kFrames + joint * 0.3f) * 0.5f;
+			XMStoreFloat4(&rotations[frame * BENCHMARK_JOINTS + joint], XMQuaternionRotationRollPitchYaw(angle, angle * 0.5f, 0.0f));
+			translations[frame * BENCHMARK_JOINTS + joint] = XMFLOAT3(0.0f, 0.1f, 0.0f);
+		}
+	}
+
+	clip.Initialize(BENCHMARK_JOINTS, kFrames, 30.0f, rotations.data(), translations.data(), scales.data(), 0.001f);
+}
+
+// A chain of tasks each awaiting the next, for the task chain case.
+static Task<unsigned int> SumTaskChain(unsigned int depth)
+{
+	if (depth == 0)
+		co_return 0;
+
+	unsigned int rest = co_await SumTaskChain(depth - 1);
+	co_return rest + depth;
+}
+
+static Task<void> RunTaskChain(unsigned int* result)
+{
+	*result = co_await SumTaskChain(BENCHMARK_TASK_DEPTH);
+}
+
+void RegisterEngineBenchmarks(Benchmark& benchmark, JobSystem* job_system, Direct3D* direct3D)
+{
+	benchmark.Add("frame_loop", [job_system]()
+	{
+		// A headless System renders to the null device, leaving the CPU cost of System::Frame. It runs its jobs on the
+		// harness workers rather than starting threads of its own.
+		std::shared_ptr<System> system(new System(), [](System* instance)
+		{
+			instance->Shutdown();
+			delete instance;
+		});
+
+		if (!system->Initialize("-headless", job_system))
+			return std::function<void()>();
+
+		return std::function<void()>([system]()
+		{
+			system->Frame(1.0f / 60.0f);
+		});
+	});
+
+	benchmark.Add("matrix_multiply", []()
+	{
+		// Combine a batch of world matrices with a view projection matrix.
+		const unsigned int kCount = 1024;
+		std::shared_ptr<std::vector<XMFLOAT4X4>> worlds = std::make_shared<std::vector<XMFLOAT4X4>>(kCount);
+		std::shared_ptr<std::vector<XMFLOAT4X4>> results = std::make_shared<std::vector<XMFLOAT4X4>>(kCount);
+		for (unsigned int i = 0; i < kCount; i++)
+			XMStoreFloat4x4(&(*worlds)[i], XMMatrixMultiply(XMMatrixRotationY(i * 0.01f), XMMatrixTranslation(static_cast<float>(i), 0.0f, 10.0f)));
+
+		XMFLOAT4X4 view_projection;
+		XMStoreFloat4x4(&view_projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 4.0f / 3.0f, 0.1f, 1000.0f));
+
+		return std::function<void()>([worlds, results, view_projection]()
+		{
+			XMMATRIX matrix = XMLoadFloat4x4(&view_projection);
+			for (unsigned int i = 0; i < kCount; i++)
+				XMStoreFloat4x4(&(*results)[i], XMMatrixMultiply(XMLoadFloat4x4(&(*worlds)[i]), matrix));
+		});
+	});
+
+	benchmark.Add("batch_matrix_multiply", []()
+	{
+		// The same work as matrix_multiply on structure of arrays data.
+		const unsigned int kCount = 1024;
+		std::shared_ptr<BatchArrays> worlds = std::make_shared<BatchArrays>(16, kCount);
+		std::shared_ptr<BatchArrays> view_projections = std::make_shared<BatchArrays>(16, kCount);
+		std::shared_ptr<BatchArrays> results = std::make_shared<BatchArrays>(16, kCount);
+		BuildTestWorlds(*worlds, kCount);
+
+		XMFLOAT4X4 view_projection;
+		XMStoreFloat4x4(&view_projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 4.0f / 3.0f, 0.1f, 1000.0f));
+		for (int element = 0; element < 16; element++)
+			view_projections->components[element].assign(kCount, (&view_projection._11)[element]);
+
+		return std::function<void()>([worlds, view_projections, results]()
+		{
+			MatrixSoA result = results->Matrices();
+			BatchMultiplyMatrices(worlds->Matrices(), view_projections->Matrices(), result, kCount);
+		});
+	});
+
+	benchmark.Add("batch_box_transform", []()
+	{
+		// Move every object's local bounds into world space, as a culling pass does before testing the frustum.
+		std::shared_ptr<BatchArrays> worlds = std::make_shared<BatchArrays>(16, BENCHMARK_TRANSFORMS);
+		std::shared_ptr<BatchArrays> boxes = std::make_shared<BatchArrays>(6, BENCHMARK_TRANSFORMS);
+		std::shared_ptr<BatchArrays> results = std::make_shared<BatchArrays>(6, BENCHMARK_TRANSFORMS);
+		BuildTestWorlds(*worlds, BENCHMARK_TRANSFORMS);
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			boxes->components[axis].assign(BENCHMARK_TRANSFORMS, -1.0f);
+			boxes->components[3 + axis].assign(BENCHMARK_TRANSFORMS, 1.0f);
+		}
+
+		return std::function<void()>([worlds, boxes, results]()
+		{
+			BoxSoA result = results->Boxes();
+			BatchTransformBoxes(worlds->Matrices(), boxes->Boxes(), result, BENCHMARK_TRANSFORMS);
+		});
+	});
+
+	benchmark.Add("batch_quaternion_to_matrix", []()
+	{
+		// Turn a batch of joint rotations into matrices.
+		std::shared_ptr<BatchArrays> rotations = std::make_shared<BatchArrays>(4, BENCHMARK_TRANSFORMS);
+		std::shared_ptr<BatchArrays> results = std::make_shared<BatchArrays>(16, BENCHMARK_TRANSFORMS);
+		for (unsigned int i = 0; i < BENCHMARK_TRANSFORMS; i++)
+		{
+			XMFLOAT4 rotation;
+			XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(i * 0.01f, i * 0.02f, i * 0.03f));
+			rotations->components[0][i] = rotation.x;
+			rotations->components[1][i] = rotation.y;
+			rotations->components[2][i] = rotation.z;
+			rotations->components[3][i] = rotation.w;
+		}
+
+		return std::function<void()>([rotations, results]()
+		{
+			QuaternionSoA source = { rotations->components[0].data(), rotations->components[1].data(), rotations->components[2].data(), rotations->components[3].data() };
+			MatrixSoA result = results->Matrices();
+			BatchQuaternionsToMatrices(source, result, BENCHMARK_TRANSFORMS);
+		});
+	});
+
+	benchmark.Add("mesh_lod_build", []()
+	{
+		// Simplify a sphere into its full LOD chain, the offline cost per mesh.
+		std::shared_ptr<std::vector<XMFLOAT3>> positions = std::make_shared<std::vector<XMFLOAT3>>();
+		std::shared_ptr<std::vector<unsigned int>> indices = std::make_shared<std::vector<unsigned int>>();
+		BuildTestSphere(*positions, *indices);
+
+		return std::function<void()>([positions, indices]()
+		{
+			MeshLod lod;
+			lod.Initialize(positions->data(), static_cast<unsigned int>(positions->size()), indices->data(), static_cast<unsigned int>(indices->size()));
+			lod.Shutdown();
+		});
+	});
+
+	benchmark.Add("lod_select", [direct3D]()
+	{
+		// Pick levels for a field of objects while the camera moves back and forth through it.
+		if (!direct3D)
+			return std::function<void()>();
+
+		struct State
+		{
+			MeshLod mesh;
+			LodSelector selector;
+			float time;
+		};
+		std::shared_ptr<State> state = std::make_shared<State>();
+		state->time = 0.0f;
+
+		std::vector<XMFLOAT3> positions;
+		std::vector<unsigned int> indices;
+		BuildTestSphere(positions, indices);
+		if (!state->mesh.Initialize(positions.data(), static_cast<unsigned int>(positions.size()), indices.data(), static_cast<unsigned int>(indices.size())) ||
+			!state->selector.Initialize(WINDOWED_SCREEN_HEIGHT, 1.0f))
+			return std::function<void()>();
+
+		for (unsigned int i = 0; i < BENCHMARK_TRANSFORMS; i++)
+		{
+			XMFLOAT4X4 world;
+			XMStoreFloat4x4(&world, XMMatrixTranslation(static_cast<float>(i % 64) * 4.0f, 0.0f, static_cast<float>(i / 64) * 4.0f));
+			state->selector.AddObject(&state->mesh, world);
+		}
+
+		return std::function<void()>([state, direct3D]()
+		{
+			state->time += 1.0f / 60.0f;
+			state->selector.Frame(direct3D, XMMatrixTranslation(-128.0f, -10.0f, sinf(state->time) * 100.0f));
+		});
+	});
+
+	benchmark.Add("sprite_batch", [direct3D]()
+	{
+		// Sort, write and submit a frame of sprites spread over four textures and four layers, plus a block of text.
+		if (!direct3D)
+			return std::function<void()>();
+
+		struct State
+		{
+			TextureAtlas atlases[4];
+			TextureAtlas glyph_atlas;
+			Font font;
+			SpriteBatch batch;
+			std::vector<unsigned int> layers;
+		};
+		std::shared_ptr<State> state(new State(), [](State* instance)
+		{
+			instance->batch.Shutdown();
+			instance->font.Shutdown();
+			instance->glyph_atlas.Shutdown();
+			for (TextureAtlas& atlas : instance->atlases)
+				atlas.Shutdown();
+			delete instance;
+		});
+
+		for (TextureAtlas& atlas : state->atlases)
+		{
+			if (!atlas.Initialize(direct3D, 64, 64))
+				return std::function<void()>();
+		}
+
+		if (!state->glyph_atlas.Initialize(direct3D, BENCHMARK_GLYPH_ATLAS_SIZE, BENCHMARK_GLYPH_ATLAS_SIZE))
+			return std::function<void()>();
+
+		if (!state->font.Initialize(direct3D, &state->glyph_atlas, L"Consolas", 16) || !state->batch.Initialize(direct3D, WINDOWED_SCREEN_WIDTH, WINDOWED_SCREEN_HEIGHT))
+			return std::function<void()>();
+
+		for (unsigned int i = 0; i < BENCHMARK_SPRITES; i++)
+			state->layers.push_back((i * 2654435761u) >> 30);
+
+		return std::function<void()>([state, direct3D]()
+		{
+			state->batch.Begin();
+			for (unsigned int i = 0; i < BENCHMARK_SPRITES; i++)
+			{
+				XMFLOAT4 destination(static_cast<float>(i % 100) * 8.0f, static_cast<float>(i / 100) * 7.0f, 8.0f, 8.0f);
+				state->batch.Draw(state->atlases[i % 4].GetTexture(), destination, XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 0.5f), state->layers[i]);
+			}
+
+			for (int line = 0; line < 16; line++)
+				state->batch.DrawString(&state->font, L"The quick brown fox jumps over the lazy dog 0123456789", 8.0f, 8.0f + line * 18.0f, XMFLOAT4(1.0f, 1.0f, 0.0f, 1.0f), 4);
+
+			state->batch.End(direct3D);
+		});
+	});
+
+	benchmark.Add("sprite_sort", [direct3D]()
+	{
+		// Build the sort keys of the sprite batch case's quads and sort them, without writing or drawing anything.
+		if (!direct3D)
+			return std::function<void()>();
+
+		struct State
+		{
+			TextureAtlas atlases[4];
+			SpriteBatch batch;
+			std::vector<unsigned int> layers;
+		};
+		std::shared_ptr<State> state(new State(), [](State* instance)
+		{
+			instance->batch.Shutdown();
+			for (TextureAtlas& atlas : instance->atlases)
+				atlas.Shutdown();
+			delete instance;
+		});
+
+		for (TextureAtlas& atlas : state->atlases)
+		{
+			if (!atlas.Initialize(direct3D, 64, 64))
+				return std::function<void()>();
+		}
+
+		if (!state->batch.Initialize(direct3D, WINDOWED_SCREEN_WIDTH, WINDOWED_SCREEN_HEIGHT))
+			return std::function<void()>();
+
+		for (unsigned int i = 0; i < BENCHMARK_SPRITES; i++)
+			state->layers.push_back((i * 2654435761u) >> 30);
+
+		return std::function<void()>([state]()
+		{
+			state->batch.Begin();
+			for (unsigned int i = 0; i < BENCHMARK_SPRITES; i++)
+			{
+				XMFLOAT4 destination(static_cast<float>(i % 100) * 8.0f, static_cast<float>(i / 100) * 7.0f, 8.0f, 8.0f);
+				state->batch.Draw(state->atlases[i % 4].GetTexture(), destination, XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 0.5f), state->layers[i]);
+			}
+			state->batch.Sort();
+		});
+	});
+
+	benchmark.Add("light_assignment", [direct3D, job_system]()
+	{
+		// Move a field of point and spot lights in front of the camera and assign them to clusters.
+		if (!direct3D)
+			return std::function<void()>();
+
+		struct State
+		{
+			LightClusters clusters;
+			float time;
+		};
+		std::shared_ptr<State> state(new State(), [](State* instance)
+		{
+			instance->clusters.Shutdown();
+			delete instance;
+		});
+		state->time = 0.0f;
+
+		if (!state->clusters.Initialize(direct3D, job_system, WINDOWED_SCREEN_WIDTH, WINDOWED_SCREEN_HEIGHT, SCREEN_NEAR, SCREEN_DEPTH))
+			return std::function<void()>();
+
+		return std::function<void()>([state]()
+		{
+			state->time += 1.0f / 60.0f;
+			state->clusters.ClearLights();
+			for (unsigned int i = 0; i < BENCHMARK_LIGHTS; i++)
+			{
+				float angle = state->time + i * 0.37f;
+				XMFLOAT3 position(static_cast<float>(i % 32) * 4.0f - 64.0f + sinf(angle) * 2.0f, static_cast<float>((i / 32) % 4) * 3.0f, static_cast<float>(i / 32) * 6.0f + 4.0f);
+				XMFLOAT3 colour(1.0f, 0.9f, 0.8f);
+				if (i % 2 == 0)
+					state->clusters.AddPointLight(position, 5.0f, colour);
+				else
+					state->clusters.AddSpotLight(position, XMFLOAT3(cosf(angle), -1.0f, sinf(angle)), 12.0f, 0.5f, colour);
+			}
+
+			state->clusters.Frame(XMMatrixIdentity());
+		});
+	});
+
+	benchmark.Add("scene_load", []()
+	{
+		// Map, validate and fix up a large scene file, then read every position as a level load would.
+		SceneWriter writer;
+		int mesh = writer.AddResource(SCENE_RESOURCE_MESH, "meshes/crate.mesh");
+		int material = writer.AddResource(SCENE_RESOURCE_MATERIAL, "materials/wood.material");
+		for (unsigned int i = 0; i < BENCHMARK_SCENE_ENTITIES; i++)
+		{
+			XMFLOAT3 position(static_cast<float>(i % 256) * 2.0f, 0.0f, static_cast<float>(i / 256) * 2.0f);
+			unsigned int parent = i < 256 ? SCENE_NO_PARENT : i % 256;
+			writer.AddEntity(i, parent, position, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), mesh, material);
+		}
+
+		bool written = writer.Write(BENCHMARK_SCENE_PATH);
+		writer.Shutdown();
+		if (!written)
+			return std::function<void()>();
+
+		// Skip the case if the file does not load, rather than timing a failed load.
+		SceneFile check;
+		bool loaded = check.Initialize(BENCHMARK_SCENE_PATH);
+		check.Shutdown();
+		if (!loaded)
+		{
+			remove(BENCHMARK_SCENE_PATH);
+			return std::function<void()>();
+		}
+
+		// Remove the file once the case is done with it.
+		std::shared_ptr<float> sum(new float(0.0f), [](float* instance)
+		{
+			remove(BENCHMARK_SCENE_PATH);
+			delete instance;
+		});
+
+		return std::function<void()>([sum]()
+		{
+			// The file loaded during setup, so a failure here would make the timing meaningless.
+			SceneFile scene;
+			if (!scene.Initialize(BENCHMARK_SCENE_PATH))
+			{
+				printf("scene_load: failed to load %s\n", BENCHMARK_SCENE_PATH);
+				abort();
+			}
+
+			Float3SoA positions = scene.GetPositions();
+			for (unsigned int i = 0; i < scene.GetEntityCount(); i++)
+				*sum += positions.x[i] + positions.y[i] + positions.z[i];
+
+			scene.Shutdown();
+		});
+	});
+
+	benchmark.Add("animation_sample_blend", []()
+	{
+		// Sample two compressed clips and blend them for a single character.
+		struct State
+		{
+			Skeleton skeleton;
+			AnimationClip walk, run;
+			std::vector<JointGroup> pose_a, pose_b, pose;
+			float time;
+		};
+		std::shared_ptr<State> state = std::make_shared<State>();
+		BuildTestAnimation(state->skeleton, state->walk, 1.0f);
+		BuildTestAnimation(state->skeleton, state->run, 2.0f);
+		state->pose_a.resize(BENCHMARK_JOINTS / 4);
+		state->pose_b.resize(BENCHMARK_JOINTS / 4);
+		state->pose.resize(BENCHMARK_JOINTS / 4);
+		state->time = 0.0f;
+
+		return std::function<void()>([state]()
+		{
+			state->time += 1.0f / 60.0f;
+			state->walk.Sample(state->time, state->pose_a.data());
+			state->run.Sample(state->time, state->pose_b.data());
+			BlendPoses(state->pose_a.data(), state->pose_b.data(), 0.3f, BENCHMARK_JOINTS / 4, state->pose.data());
+		});
+	});
+
+	benchmark.Add("animation_update", [job_system, direct3D]()
+	{
+		// Update a crowd of characters across the worker threads, then upload each skinning palette through the constant
+		// buffer as the render pass does.
+		if (!direct3D)
+			return std::function<void()>();
+
+		struct State
+		{
+			Skeleton skeleton;
+			AnimationClip walk, run;
+			Animation animation;
+		};
+		std::shared_ptr<State> state(new State(), [](State* instance)
+		{
+			instance->animation.Shutdown();
+			delete instance;
+		});
+
+		BuildTestAnimation(state->skeleton, state->walk, 1.0f);
+		BuildTestAnimation(state->skeleton, state->run, 2.0f);
+		if (!state->animation.Initialize(direct3D, job_system))
+			return std::function<void()>();
+
+		for (unsigned int i = 0; i < BENCHMARK_CHARACTERS; i++)
+		{
+			int character = state->animation.AddCharacter(&state->skeleton, &state->walk, &state->run);
+			state->animation.SetBlendWeight(character, (i % 10) / 10.0f);
+		}
+
+		return std::function<void()>([state, direct3D]()
+		{
+			state->animation.Frame(1.0f / 60.0f);
+			for (unsigned int character = 0; character < BENCHMARK_CHARACTERS; character++)
+				state->animation.SetPalette(direct3D, character);
+		});
+	});
+
+	benchmark.Add("broadphase_update", [job_system]()
+	{
+		// Move a field of boxes a little each frame and rebuild the overlapping pairs.
+		struct State
+		{
+			Broadphase broadphase;
+			std::vector<XMFLOAT3> centres;
+			float time;
+		};
+		std::shared_ptr<State> state = std::make_shared<State>();
+		state->broadphase.Initialize(job_system);
+		state->time = 0.0f;
+
+		for (unsigned int i = 0; i < BENCHMARK_PROXIES; i++)
+		{
+			XMFLOAT3 centre(static_cast<float>(i % 64) * 2.0f, static_cast<float>((i / 64) % 8) * 2.0f, static_cast<float>(i / 512) * 2.0f);
+			state->centres.push_back(centre);
+			state->broadphase.CreateProxy(XMFLOAT3(centre.x - 1.0f, centre.y - 1.0f, centre.z - 1.0f), XMFLOAT3(centre.x + 1.0f, centre.y + 1.0f, centre.z + 1.0f));
+		}
+
+		return std::function<void()>([state]()
+		{
+			state->time += 1.0f / 60.0f;
+			for (unsigned int i = 0; i < BENCHMARK_PROXIES; i++)
+			{
+				const XMFLOAT3& centre = state->centres[i];
+				float offset = sinf(state->time + i) * 0.5f;
+				state->broadphase.UpdateProxy(i, XMFLOAT3(centre.x + offset - 1.0f, centre.y - 1.0f, centre.z - 1.0f),
+					XMFLOAT3(centre.x + offset + 1.0f, centre.y + 1.0f, centre.z + 1.0f));
+			}
+
+			state->broadphase.Frame();
+		});
+	});
+
+	benchmark.Add("pool_allocate", []()
+	{
+		// Allocate and free blocks of mixed sizes, as coroutine frames come and go.
+		struct State
+		{
+			PoolAllocator pool;
+			std::vector<void*> blocks;
+		};
+		std::shared_ptr<State> state(new State(), [](State* instance)
+		{
+			instance->pool.Shutdown();
+			delete instance;
+		});
+		state->blocks.resize(BENCHMARK_POOL_BLOCKS);
+
+		return std::function<void()>([state]()
+		{
+			for (unsigned int i = 0; i < BENCHMARK_POOL_BLOCKS; i++)
+				state->blocks[i] = state->pool.Allocate(48 + (i * 2654435761u) % 1024);
+
+			for (unsigned int i = 0; i < BENCHMARK_POOL_BLOCKS; i++)
+				state->pool.Free(state->blocks[i], 48 + (i * 2654435761u) % 1024);
+		});
+	});
+
+	benchmark.Add("task_chain", [job_system]()
+	{
+		// Spawn a task that awaits a deep chain of tasks and run it to completion on the main thread.
+		struct State
+		{
+			TaskScheduler scheduler;
+			unsigned int result;
+		};
+		std::shared_ptr<State> state(new State(), [](State* instance)
+		{
+			instance->scheduler.Shutdown();
+			delete instance;
+		});
+
+		if (!state->scheduler.Initialize(job_system))
+			return std::function<void()>();
+
+		return std::function<void()>([state]()
+		{
+			state->scheduler.Spawn(RunTaskChain(&state->result), TASK_THREAD_MAIN);
+			state->scheduler.RunMain(0.0f);
+		});
+	});
+
+	benchmark.Add("job_dispatch", [job_system]()
+	{
+		// Spread a small amount of work across the workers to measure the dispatch overhead.
+		std::shared_ptr<std::vector<unsigned int>> values = std::make_shared<std::vector<unsigned int>>(4096);
+
+		return std::function<void()>([job_system, values]()
+		{
+			job_system->Dispatch(static_cast<unsigned int>(values->size()), 64, [&values](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int i = begin; i < end; i++)
+					(*values)[i] = (*values)[i] * 1664525u + 1013904223u;
+			});
+		});
+	});
+}
@@ -0,0 +1,131 @@
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "batchMath.h"
+#include "benchmark.h"
+#include "graphics.h"
+#include "jobSystem.h"
+#include "system.h"
+
+static void PrintUsage()
+{
+	printf("Usage: EngineBenchmark [options]\n");
+	printf("  --list                 List the benchmark cases.\n");
+	printf("  --filter <text>        Only run cases whose name contains the text.\n");
+	printf("  --samples <count>      Samples taken of each case (default 100).\n");
+	printf("  --output <file>        Write the results as JSON.\n");
+	printf("  --baseline <file>      Compare against a previous results file.\n");
+	printf("  --threshold <percent>  Allowed slowdown against the baseline (default 10).\n");
+	printf("  --metric <p50|p95|p99> Percentile compared against the baseline (default p50).\n");
+}
+
+int main(int argc, char** argv)
+{
+	std::string filter, output_path, baseline_path, metric = "p50";
+	unsigned int samples = 100;
+	double threshold = 10.0;
+	bool list = false;
+
+	// Read the options.
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		bool has_value = i + 1 < argc;
+
+		if (option == "--list")
+			list = true;
+		else if (option == "--filter" && has_value)
+			filter = argv[++i];
+		else if (option == "--samples" && has_value)
+			samples = static_cast<unsigned int>(strtoul(argv[++i], 0, 10));
+		else if (option == "--output" && has_value)
+			output_path = argv[++i];
+		else if (option == "--baseline" && has_value)
+			baseline_path = argv[++i];
+		else if (option == "--threshold" && has_value)
+			threshold = strtod(argv[++i], 0);
+		else if (option == "--metric" && has_value)
+			metric = argv[++i];
+		else
+		{
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	if (samples == 0 || (metric != "p50" && metric != "p95" && metric != "p99"))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	// Start the worker threads shared by the cases.
+	JobSystem job_system;
+	job_system.Initialize(0);
+
+	// Cases that create Direct3D resources use a null device so no window or GPU work is involved.
+	Direct3D* direct3D = new Direct3D();
+	if (!direct3D->Initialize(WINDOWED_SCREEN_WIDTH, WINDOWED_SCREEN_HEIGHT, false, 0, false, SCREEN_DEPTH, SCREEN_NEAR))
+	{
+		printf("Failed to create a null Direct3D device; cases that need one are skipped.\n");
+		direct3D->Shutdown();
+		delete direct3D;
+		direct3D = 0;
+	}
+
+	Benchmark benchmark;
+	RegisterEngineBenchmarks(benchmark, &job_system, direct3D);
+
+	int exit_code = 0;
+	if (list)
+	{
+		benchmark.List();
+	}
+	else
+	{
+		// Run the cases and record the results. Batch math timings depend on the instruction set, so say which one ran.
+		printf("Batch math: %s\n\n", GetBatchInstructionSetName());
+		std::vector<BenchmarkResult> results;
+		benchmark.Run(filter, samples, results);
+
+		if (!output_path.empty() && !Benchmark::WriteResults(output_path.c_str(), results))
+		{
+			printf("Failed to write %s\n", output_path.c_str());
+			exit_code = 2;
+		}
+
+		// Fail the run when a case regressed past the threshold.
+		if (!baseline_path.empty())
+		{
+			std::vector<BenchmarkResult> baseline;
+			if (!Benchmark::ReadResults(baseline_path.c_str(), baseline))
+			{
+				printf("Failed to read %s\n", baseline_path.c_str());
+				exit_code = 2;
+			}
+			else
+			{
+				// Only the cases selected by the filter are expected to have run.
+				baseline.erase(std::remove_if(baseline.begin(), baseline.end(),
+					[&filter](const BenchmarkResult& result) { return result.name.find(filter) == std::string::npos; }), baseline.end());
+
+				if (!Benchmark::Compare(baseline, results, metric, threshold))
+					exit_code = 1;
+			}
+		}
+	}
+
+	// Release the null device and the worker threads.
+	if (direct3D)
+	{
+		direct3D->Shutdown();
+		delete direct3D;
+		direct3D = 0;
+	}
+	job_system.Shutdown();
+
+	return exit_code;
+}
@@ -0,0 +1,607 @@
+#include "animation.h"
+
+#include <algorithm>
+#include <cmath>
+#include "direct3D.h"
+#include "jobSystem.h"
+
+// Quantize a unit quaternion with the "smallest three" method. The largest component is dropped and rebuilt on decode,
+// which bounds the other three to [-1/sqrt(2), 1/sqrt(2)] so they fit in 15 bits each. The index of the dropped
+// component is stored in the two spare top bits.
+static void EncodeQuaternion(const XMFLOAT4& rotation, unsigned short* key)
+{
+	float components[4] { rotation.x, rotation.y, rotation.z, rotation.w };
+
+	// Find the largest component and flip the quaternion so it is positive (q and -q are the same rotation).
+	int largest = 0;
+	for (int i = 1; i < 4; i++)
+	{
+		if (fabsf(components[i]) > fabsf(components[largest]))
+			largest = i;
+	}
+	float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+	// Map the remaining components onto [0, 32767].
+	int k = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		if (i == largest)
+			continue;
+
+		float normalized = (components[i] * sign * XM_SQRT2 + 1.0f) * 0.5f;
+		normalized = (std::min)((std::max)(normalized, 0.0f), 1.0f);
+		key[k++] = static_cast<unsigned short>(normalized * 32767.0f + 0.5f);
+	}
+
+	key[0] |= static_cast<unsigned short>((largest >> 1) << 15);
+	key[1] |= static_cast<unsigned short>((largest & 1) << 15);
+}
+
+static XMVECTOR DecodeQuaternion(const unsigned short* key)
+{
+	int largest = ((key[0] >> 15) << 1) | (key[1] >> 15);
+
+	// Expand the three stored components and rebuild the dropped one from the unit length constraint.
+	float components[4];
+	float sum = 0.0f;
+	int k = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		if (i == largest)
+			continue;
+
+		components[i] = ((key[k++] & 0x7FFF) * (2.0f / 32767.0f) - 1.0f) * (1.0f / XM_SQRT2);
+		sum += components[i] * components[i];
+	}
+	components[largest] = sqrtf((std::max)(1.0f - sum, 0.0f));
+
+	return XMVectorSet(components[0], components[1], components[2], components[3]);
+}
+
+// Greedily select the keys of a track. A frame is only kept when interpolating between the previous kept key and the
+// following frame no longer reproduces every frame in between within tolerance.
+// within(start, end, frame) reports whether interpolating start -> end reproduces the given frame.
+template <typename Within>
+static void ReduceKeys(unsigned int frame_count, Within within, std::vector<unsigned short>& kept)
+{
+	kept.clear();
+	kept.push_back(0);
+
+	// A constant track only needs its first key.
+	bool constant = true;
+	for (unsigned int frame = 1; frame < frame_count && constant; frame++)
+		constant = within(0, 0, frame);
+
+	if (constant)
+		return;
+
+	unsigned int start = 0;
+	for (unsigned int end = 2; end < frame_count; end++)
+	{
+		for (unsigned int frame = start + 1; frame < end; frame++)
+		{
+			if (!within(start, end, frame))
+			{
+				kept.push_back(static_cast<unsigned short>(end - 1));
+				start = end - 1;
+				break;
+			}
+		}
+	}
+
+	kept.push_back(static_cast<unsigned short>(frame_count - 1));
+}
+
+static float InterpolationFactor(unsigned int start, unsigned int end, unsigned int frame)
+{
+	return end == start ? 0.0f : static_cast<float>(frame - start) / static_cast<float>(end - start);
+}
+
+static void ResetPose(std::vector<JointGroup>& pose, unsigned int joint_count)
+{
+	// Every lane starts at the identity, including the padding lanes of the final group, so SIMD work on them stays finite.
+	JointGroup identity;
+	for (int lane = 0; lane < 4; lane++)
+	{
+		identity.rotation_x[lane] = identity.rotation_y[lane] = identity.rotation_z[lane] = 0.0f;
+		identity.rotation_w[lane] = 1.0f;
+		identity.translation_x[lane] = identity.translation_y[lane] = identity.translation_z[lane] = 0.0f;
+		identity.scale_x[lane] = identity.scale_y[lane] = identity.scale_z[lane] = 1.0f;
+	}
+
+	pose.assign((joint_count + 3) / 4, identity);
+}
+
+AnimationClip::AnimationClip() :
+	joint_count_(0),
+	frame_count_(0),
+	frame_rate_(0.0f)
+{
+}
+
+AnimationClip::AnimationClip(const AnimationClip& kOther)
+{
+}
+
+AnimationClip::~AnimationClip()
+{
+}
+
+bool AnimationClip::Initialize(unsigned int joint_count, unsigned int frame_count, float frame_rate,
+	const XMFLOAT4* rotations, const XMFLOAT3* translations, const XMFLOAT3* scales, float tolerance)
+{
+	// Key frames are stored as 16-bit frame indices.
+	if (joint_count == 0 || frame_count == 0 || frame_count > 65536 || frame_rate <= 0.0f)
+		return false;
+
+	joint_count_ = joint_count;
+	frame_count_ = frame_count;
+	frame_rate_ = frame_rate;
+
+	// Gather the frames of each joint and compress them into a track per channel.
+	std::vector<XMFLOAT4> rotation_series(frame_count);
+	std::vector<XMFLOAT3> translation_series(frame_count);
+	std::vector<XMFLOAT3> scale_series(frame_count);
+	for (unsigned int joint = 0; joint < joint_count; joint++)
+	{
+		for (unsigned int frame = 0; frame < frame_count; frame++)
+		{
+			rotation_series[frame] = rotations[frame * joint_count + joint];
+			translation_series[frame] = translations[frame * joint_count + joint];
+			scale_series[frame] = scales[frame * joint_count + joint];
+		}
+
+		AddRotationTrack(rotation_series.data(), frame_count, tolerance);
+		AddVectorTrack(translation_series.data(), frame_count, tolerance, translation_tracks_);
+		AddVectorTrack(scale_series.data(), frame_count, tolerance, scale_tracks_);
+	}
+
+	return true;
+}
+
+void AnimationClip::Shutdown()
+{
+	rotation_tracks_.clear();
+	translation_tracks_.clear();
+	scale_tracks_.clear();
+	key_frames_.clear();
+	key_values_.clear();
+	joint_count_ = 0;
+	frame_count_ = 0;
+}
+
+void AnimationClip::Sample(float time, JointGroup* pose) const
+{
+	// Convert the time into a fractional frame, looping over the clip.
+	float last_frame = static_cast<float>(frame_count_ - 1);
+	float frame = 0.0f;
+	if (last_frame > 0.0f)
+	{
+		frame = fmodf(time * frame_rate_, last_frame);
+		if (frame < 0.0f)
+			frame += last_frame;
+	}
+
+	const XMVECTOR kOne = XMVectorReplicate(1.0f);
+	const XMVECTOR kNegativeOne = XMVectorReplicate(-1.0f);
+
+	for (unsigned int first_joint = 0; first_joint < joint_count_; first_joint += 4)
+	{
+		JointGroup& group = pose[first_joint >> 2];
+
+		// Finding and decoding the keys is done joint by joint. Padding lanes past the last joint sample the identity.
+		XMVECTOR rotations_0[4], rotations_1[4];
+		float rotation_alpha[4], translation_alpha[4], scale_alpha[4];
+		float keys_0[6][4], keys_1[6][4], minimum[6][4], step[6][4];
+		for (unsigned int lane = 0; lane < 4; lane++)
+		{
+			unsigned int joint = first_joint + lane;
+			if (joint >= joint_count_)
+			{
+				rotations_0[lane] = rotations_1[lane] = XMQuaternionIdentity();
+				rotation_alpha[lane] = translation_alpha[lane] = scale_alpha[lane] = 0.0f;
+				for (int channel = 0; channel < 6; channel++)
+				{
+					keys_0[channel][lane] = keys_1[channel][lane] = step[channel][lane] = 0.0f;
+					minimum[channel][lane] = channel < 3 ? 0.0f : 1.0f;
+				}
+				continue;
+			}
+
+			unsigned int key_0, key_1;
+			FindKeys(rotation_tracks_[joint], frame, key_0, key_1, rotation_alpha[lane]);
+			rotations_0[lane] = DecodeQuaternion(&key_values_[key_0 * 3]);
+			rotations_1[lane] = DecodeQuaternion(&key_values_[key_1 * 3]);
+
+			const Track* tracks[2] { &translation_tracks_[joint], &scale_tracks_[joint] };
+			float* alphas[2] { translation_alpha, scale_alpha };
+			for (int i = 0; i < 2; i++)
+			{
+				const Track& track = *tracks[i];
+				FindKeys(track, frame, key_0, key_1, alphas[i][lane]);
+
+				float track_minimum[3] { track.minimum.x, track.minimum.y, track.minimum.z };
+				float track_step[3] { track.step.x, track.step.y, track.step.z };
+				for (int component = 0; component < 3; component++)
+				{
+					int channel = i * 3 + component;
+					keys_0[channel][lane] = key_values_[key_0 * 3 + component];
+					keys_1[channel][lane] = key_values_[key_1 * 3 + component];
+					minimum[channel][lane] = track_minimum[component];
+					step[channel][lane] = track_step[component];
+				}
+			}
+		}
+
+		// Transpose the rotations so each vector holds one component of all four joints.
+		XMMATRIX rotation_0 = XMMatrixTranspose(XMMATRIX(rotations_0[0], rotations_0[1], rotations_0[2], rotations_0[3]));
+		XMMATRIX rotation_1 = XMMatrixTranspose(XMMATRIX(rotations_1[0], rotations_1[1], rotations_1[2], rotations_1[3]));
+
+		// Interpolate the rotations along the shortest path and renormalize, as BlendPoses does.
+		XMVECTOR dot = XMVectorMultiply(rotation_0.r[0], rotation_1.r[0]);
+		dot = XMVectorMultiplyAdd(rotation_0.r[1], rotation_1.r[1], dot);
+		dot = XMVectorMultiplyAdd(rotation_0.r[2], rotation_1.r[2], dot);
+		dot = XMVectorMultiplyAdd(rotation_0.r[3], rotation_1.r[3], dot);
+		XMVECTOR sign = XMVectorSelect(kOne, kNegativeOne, XMVectorLess(dot, XMVectorZero()));
+
+		XMVECTOR alpha = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(rotation_alpha));
+		XMVECTOR r_x = XMVectorLerpV(rotation_0.r[0], XMVectorMultiply(rotation_1.r[0], sign), alpha);
+		XMVECTOR r_y = XMVectorLerpV(rotation_0.r[1], XMVectorMultiply(rotation_1.r[1], sign), alpha);
+		XMVECTOR r_z = XMVectorLerpV(rotation_0.r[2], XMVectorMultiply(rotation_1.r[2], sign), alpha);
+		XMVECTOR r_w = XMVectorLerpV(rotation_0.r[3], XMVectorMultiply(rotation_1.r[3], sign), alpha);
+
+		XMVECTOR length_squared = XMVectorMultiply(r_x, r_x);
+		length_squared = XMVectorMultiplyAdd(r_y, r_y, length_squared);
+		length_squared = XMVectorMultiplyAdd(r_z, r_z, length_squared);
+		length_squared = XMVectorMultiplyAdd(r_w, r_w, length_squared);
+		XMVECTOR inverse_length = XMVectorReciprocalSqrt(length_squared);
+
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(group.rotation_x), XMVectorMultiply(r_x, inverse_length));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(group.rotation_y), XMVectorMultiply(r_y, inverse_length));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(group.rotation_z), XMVectorMultiply(r_z, inverse_length));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(group.rotation_w), XMVectorMultiply(r_w, inverse_length));
+
+		// Dequantize and interpolate the translations and scales: minimum + step * lerp(key_0, key_1, alpha).
+		float* outputs[6] { group.translation_x, group.translation_y, group.translation_z, group.scale_x, group.scale_y, group.scale_z };
+		for (int channel = 0; channel < 6; channel++)
+		{
+			alpha = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(channel < 3 ? translation_alpha : scale_alpha));
+			XMVECTOR key = XMVectorLerpV(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(keys_0[channel])),
+				XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(keys_1[channel])), alpha);
+			XMVECTOR value = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(step[channel])), key,
+				XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(minimum[channel])));
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(outputs[channel]), value);
+		}
+	}
+}
+
+unsigned int AnimationClip::GetJointCount() const
+{
+	return joint_count_;
+}
+
+unsigned int AnimationClip::GetKeyCount() const
+{
+	return static_cast<unsigned int>(key_frames_.size());
+}
+
+float AnimationClip::GetDuration() const
+{
+	return frame_count_ > 1 ? static_cast<float>(frame_count_ - 1) / frame_rate_ : 0.0f;
+}
+
+void AnimationClip::AddRotationTrack(const XMFLOAT4* series, unsigned int frame_count, float tolerance)
+{
+	// Normalize the rotations and keep neighbouring frames in the same hemisphere so interpolation takes the short path.
+	std::vector<XMFLOAT4> rotations(series, series + frame_count);
+	for (unsigned int frame = 0; frame < frame_count; frame++)
+	{
+		XMVECTOR rotation = XMQuaternionNormalize(XMLoadFloat4(&rotations[frame]));
+		if (frame > 0 && XMVectorGetX(XMVector4Dot(rotation, XMLoadFloat4(&rotations[frame - 1]))) < 0.0f)
+			rotation = XMVectorNegate(rotation);
+
+		XMStoreFloat4(&rotations[frame], rotation);
+	}
+
+	// Two rotations are within tolerance when the angle between them is below it: |q0 . q1| >= cos(angle / 2).
+	float minimum_dot = cosf(tolerance * 0.5f);
+	auto within = [&rotations, minimum_dot](unsigned int start, unsigned int end, unsigned int frame)
+	{
+		XMVECTOR interpolated = XMQuaternionNormalize(XMVectorLerp(XMLoadFloat4(&rotations[start]),
+			XMLoadFloat4(&rotations[end]), InterpolationFactor(start, end, frame)));
+		return fabsf(XMVectorGetX(XMVector4Dot(interpolated, XMLoadFloat4(&rotations[frame])))) >= minimum_dot;
+	};
+
+	std::vector<unsigned short> kept;
+	ReduceKeys(frame_count, within, kept);
+
+	// Quantize the kept keys.
+	Track track;
+	track.first_key = static_cast<unsigned int>(key_frames_.size());
+	track.key_count = static_cast<unsigned int>(kept.size());
+	track.minimum = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	track.step = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	for (unsigned short frame : kept)
+	{
+		unsigned short key[3];
+		EncodeQuaternion(rotations[frame], key);
+		key_frames_.push_back(frame);
+		key_values_.insert(key_values_.end(), key, key + 3);
+	}
+
+	rotation_tracks_.push_back(track);
+}
+
+void AnimationClip::AddVectorTrack(const XMFLOAT3* series, unsigned int frame_count, float tolerance, std::vector<Track>& tracks)
+{
+	// Find the range of the track so each component can be quantized to 16 bits across it.
+	XMVECTOR minimum = XMLoadFloat3(&series[0]);
+	XMVECTOR maximum = minimum;
+	for (unsigned int frame = 1; frame < frame_count; frame++)
+	{
+		minimum = XMVectorMin(minimum, XMLoadFloat3(&series[frame]));
+		maximum = XMVectorMax(maximum, XMLoadFloat3(&series[frame]));
+	}
+
+	float tolerance_squared = tolerance * tolerance;
+	auto within = [series, tolerance_squared](unsigned int start, unsigned int end, unsigned int frame)
+	{
+		XMVECTOR interpolated = XMVectorLerp(XMLoadFloat3(&series[start]), XMLoadFloat3(&series[end]), InterpolationFactor(start, end, frame));
+		return XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(interpolated, XMLoadFloat3(&series[frame])))) <= tolerance_squared;
+	};
+
+	std::vector<unsigned short> kept;
+	ReduceKeys(frame_count, within, kept);
+
+	Track track;
+	track.first_key = static_cast<unsigned int>(key_frames_.size());
+	track.key_count = static_cast<unsigned int>(kept.size());
+	XMStoreFloat3(&track.minimum, minimum);
+	XMStoreFloat3(&track.step, XMVectorScale(XMVectorSubtract(maximum, minimum), 1.0f / 65535.0f));
+
+	// Quantize the kept keys, leaving flat components at zero.
+	XMVECTOR step = XMLoadFloat3(&track.step);
+	XMVECTOR inverse_step = XMVectorSelect(XMVectorReciprocal(step), XMVectorZero(), XMVectorEqual(step, XMVectorZero()));
+	for (unsigned short frame : kept)
+	{
+		XMFLOAT3 quantized;
+		XMStoreFloat3(&quantized, XMVectorRound(XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&series[frame]), minimum), inverse_step)));
+
+		key_frames_.push_back(frame);
+		key_values_.push_back(static_cast<unsigned short>((std::min)((std::max)(quantized.x, 0.0f), 65535.0f)));
+		key_values_.push_back(static_cast<unsigned short>((std::min)((std::max)(quantized.y, 0.0f), 65535.0f)));
+		key_values_.push_back(static_cast<unsigned short>((std::min)((std::max)(quantized.z, 0.0f), 65535.0f)));
+	}
+
+	tracks.push_back(track);
+}
+
+void AnimationClip::FindKeys(const Track& track, float frame, unsigned int& key_0, unsigned int& key_1, float& alpha) const
+{
+	const unsigned short* first = &key_frames_[track.first_key];
+	const unsigned short* last = first + track.key_count;
+
+	// Find the first key after the frame; the key before it starts the interpolated span.
+	const unsigned short* next = std::upper_bound(first, last, static_cast<unsigned short>(frame));
+	if (next == last)
+	{
+		key_0 = key_1 = track.first_key + track.key_count - 1;
+		alpha = 0.0f;
+		return;
+	}
+
+	key_1 = track.first_key + static_cast<unsigned int>(next - first);
+	key_0 = key_1 - 1;
+	alpha = (frame - key_frames_[key_0]) / static_cast<float>(key_frames_[key_1] - key_frames_[key_0]);
+}
+
+void BlendPoses(const JointGroup* pose_a, const JointGroup* pose_b, float weight, unsigned int group_count, JointGroup* result)
+{
+	const XMVECTOR kOne = XMVectorReplicate(1.0f);
+	const XMVECTOR kNegativeOne = XMVectorReplicate(-1.0f);
+
+	for (unsigned int i = 0; i < group_count; i++)
+	{
+		const JointGroup& a = pose_a[i];
+		const JointGroup& b = pose_b[i];
+		JointGroup& out = result[i];
+
+		// Load the rotations of four joints at once.
+		XMVECTOR a_x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(a.rotation_x));
+		XMVECTOR a_y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(a.rotation_y));
+		XMVECTOR a_z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(a.rotation_z));
+		XMVECTOR a_w = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(a.rotation_w));
+		XMVECTOR b_x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(b.rotation_x));
+		XMVECTOR b_y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(b.rotation_y));
+		XMVECTOR b_z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(b.rotation_z));
+		XMVECTOR b_w = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(b.rotation_w));
+
+		// Flip the second rotation of any joint whose quaternions lie in opposite hemispheres.
+		XMVECTOR dot = XMVectorMultiply(a_x, b_x);
+		dot = XMVectorMultiplyAdd(a_y, b_y, dot);
+		dot = XMVectorMultiplyAdd(a_z, b_z, dot);
+		dot = XMVectorMultiplyAdd(a_w, b_w, dot);
+		XMVECTOR sign = XMVectorSelect(kOne, kNegativeOne, XMVectorLess(dot, XMVectorZero()));
+
+		// Interpolate and renormalize.
+		XMVECTOR r_x = XMVectorLerp(a_x, XMVectorMultiply(b_x, sign), weight);
+		XMVECTOR r_y = XMVectorLerp(a_y, XMVectorMultiply(b_y, sign), weight);
+		XMVECTOR r_z = XMVectorLerp(a_z, XMVectorMultiply(b_z, sign), weight);
+		XMVECTOR r_w = XMVectorLerp(a_w, XMVectorMultiply(b_w, sign), weight);
+
+		XMVECTOR length_squared = XMVectorMultiply(r_x, r_x);
+		length_squared = XMVectorMultiplyAdd(r_y, r_y, length_squared);
+		length_squared = XMVectorMultiplyAdd(r_z, r_z, length_squared);
+		length_squared = XMVectorMultiplyAdd(r_w, r_w, length_squared);
+		XMVECTOR inverse_length = XMVectorReciprocalSqrt(length_squared);
+
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(out.rotation_x), XMVectorMultiply(r_x, inverse_length));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(out.rotation_y), XMVectorMultiply(r_y, inverse_length));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(out.rotation_z), XMVectorMultiply(r_z, inverse_length));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(out.rotation_w), XMVectorMultiply(r_w, inverse_length));
+
+		// Translation and scale are interpolated linearly.
+		const float* inputs_a[6] { a.translation_x, a.translation_y, a.translation_z, a.scale_x, a.scale_y, a.scale_z };
+		const float* inputs_b[6] { b.translation_x, b.translation_y, b.translation_z, b.scale_x, b.scale_y, b.scale_z };
+		float* outputs[6] { out.translation_x, out.translation_y, out.translation_z, out.scale_x, out.scale_y, out.scale_z };
+		for (int channel = 0; channel < 6; channel++)
+		{
+			XMVECTOR value = XMVectorLerp(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(inputs_a[channel])),
+				XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(inputs_b[channel])), weight);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(outputs[channel]), value);
+		}
+	}
+}
+
+Animation::Animation() :
+	job_system_(0),
+	palette_buffer_(0)
+{
+}
+
+Animation::Animation(const Animation& kOther)
+{
+}
+
+Animation::~Animation()
+{
+}
+
+bool Animation::Initialize(Direct3D* direct3D, JobSystem* job_system)
+{
+	// Store the job system used to spread characters across the worker threads.
+	job_system_ = job_system;
+
+	// Create the constant buffer the skinning palettes are uploaded through.
+	return direct3D->CreateConstantBuffer(MAX_PALETTE_JOINTS * sizeof(XMFLOAT4X4), &palette_buffer_);
+}
+
+void Animation::Shutdown()
+{
+	// Release the palette constant buffer.
+	if (palette_buffer_)
+	{
+		palette_buffer_->Release();
+		palette_buffer_ = nullptr;
+	}
+
+	characters_.clear();
+	job_system_ = 0;
+}
+
+int Animation::AddCharacter(const Skeleton* skeleton, const AnimationClip* clip_a, const AnimationClip* clip_b)
+{
+	// The skeleton must fit in a palette and both clips must animate every one of its joints.
+	unsigned int joint_count = static_cast<unsigned int>(skeleton->parents.size());
+	if (joint_count == 0 || joint_count > MAX_PALETTE_JOINTS || skeleton->inverse_bind_matrices.size() != joint_count)
+		return -1;
+
+	if (clip_a->GetJointCount() != joint_count || clip_b->GetJointCount() != joint_count)
+		return -1;
+
+	Character character;
+	character.skeleton = skeleton;
+	character.clip_a = clip_a;
+	character.clip_b = clip_b;
+	character.phase = 0.0f;
+	character.playback_rate = 1.0f;
+	character.blend_weight = 0.0f;
+	ResetPose(character.pose_a, joint_count);
+	ResetPose(character.pose_b, joint_count);
+	ResetPose(character.pose, joint_count);
+	character.model_matrices.resize(joint_count);
+	character.palette.resize(joint_count);
+
+	characters_.push_back(character);
+	return static_cast<int>(characters_.size() - 1);
+}
+
+void Animation::SetBlendWeight(unsigned int character, float weight)
+{
+	characters_[character].blend_weight = (std::min)((std::max)(weight, 0.0f), 1.0f);
+}
+
+void Animation::SetPlaybackRate(unsigned int character, float rate)
+{
+	characters_[character].playback_rate = rate;
+}
+
+void Animation::Frame(float frame_time)
+{
+	// Characters are independent so they are updated in batches across the worker threads.
+	auto update = [this, frame_time](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+			UpdateCharacter(characters_[i], frame_time);
+	};
+
+	unsigned int character_count = static_cast<unsigned int>(characters_.size());
+	if (job_system_)
+		job_system_->Dispatch(character_count, CHARACTERS_PER_JOB, update);
+	else
+		update(0, character_count);
+}
+
+bool Animation::SetPalette(Direct3D* direct3D, unsigned int character)
+{
+	if (character >= characters_.size())
+		return false;
+
+	// Upload only the joints the character uses.
+	const std::vector<XMFLOAT4X4>& palette = characters_[character].palette;
+	if (!direct3D->UpdateConstantBuffer(palette_buffer_, palette.data(), static_cast<unsigned int>(palette.size() * sizeof(XMFLOAT4X4))))
+		return false;
+
+	// Bind the palette to the vertex shader.
+	direct3D->GetDeviceContext()->VSSetConstantBuffers(PALETTE_BUFFER_SLOT, 1, &palette_buffer_);
+	return true;
+}
+
+unsigned int Animation::GetCharacterCount()
+{
+	return static_cast<unsigned int>(characters_.size());
+}
+
+void Animation::UpdateCharacter(Character& character, float frame_time)
+{
+	unsigned int joint_count = static_cast<unsigned int>(character.skeleton->parents.size());
+	unsigned int group_count = static_cast<unsigned int>(character.pose.size());
+
+	// Advance a normalized phase shared by both clips so blended cycles of different lengths stay in step.
+	float duration_a = character.clip_a->GetDuration();
+	float duration_b = character.clip_b->GetDuration();
+	float duration = duration_a + (duration_b - duration_a) * character.blend_weight;
+	if (duration > 0.0f)
+	{
+		character.phase += frame_time * character.playback_rate / duration;
+		character.phase -= floorf(character.phase);
+	}
+
+	// Sample both clips and blend them together.
+	character.clip_a->Sample(character.phase * duration_a, character.pose_a.data());
+	character.clip_b->Sample(character.phase * duration_b, character.pose_b.data());
+	BlendPoses(character.pose_a.data(), character.pose_b.data(), character.blend_weight, group_count, character.pose.data());
+
+	// Walk the hierarchy to build the model space transforms, then combine them with the inverse bind matrices.
+	for (unsigned int joint = 0; joint < joint_count; joint++)
+	{
+		const JointGroup& group = character.pose[joint >> 2];
+		unsigned int lane = joint & 3;
+
+		XMVECTOR rotation = XMVectorSet(group.rotation_x[lane], group.rotation_y[lane], group.rotation_z[lane], group.rotation_w[lane]);
+		XMVECTOR translation = XMVectorSet(group.translation_x[lane], group.translation_y[lane], group.translation_z[lane], 0.0f);
+		XMVECTOR scale = XMVectorSet(group.scale_x[lane], group.scale_y[lane], group.scale_z[lane], 0.0f);
+		XMMATRIX model = XMMatrixAffineTransformation(scale, XMVectorZero(), rotation, translation);
+
+		int parent = character.skeleton->parents[joint];
+		if (parent >= 0)
+			model = XMMatrixMultiply(model, XMLoadFloat4x4(&character.model_matrices[parent]));
+
+		XMStoreFloat4x4(&character.model_matrices[joint], model);
+
+		// Shaders read matrices column major so the palette is stored transposed.
+		XMMATRIX skin = XMMatrixMultiply(XMLoadFloat4x4(&character.skeleton->inverse_bind_matrices[joint]), model);
+		XMStoreFloat4x4(&character.palette[joint], XMMatrixTranspose(skin));
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include <d3d11.h>
+#include <DirectXMath.h>
+using namespace DirectX;
+
+class Direct3D;
+class JobSystem;
+
+// The largest skinning palette uploaded for a single character (128 matrices = 8KB of constant buffer).
+const unsigned int MAX_PALETTE_JOINTS = 128;
+
+// The vertex shader constant buffer slot the skinning palette is bound to.
+const unsigned int PALETTE_BUFFER_SLOT = 1;
+
+// Characters updated by a single job when the animation frame is spread across the worker threads.
+const unsigned int CHARACTERS_PER_JOB = 8;
+
+struct Skeleton
+{
+	// Parent index of each joint (-1 for a root). Parents must always come before their children.
+	std::vector<int> parents;
+	std::vector<XMFLOAT4X4> inverse_bind_matrices;
+};
+
+// Local joint transforms for four joints stored component by component so a single SIMD instruction processes all four.
+struct JointGroup
+{
+	float rotation_x[4], rotation_y[4], rotation_z[4], rotation_w[4];
+	float translation_x[4], translation_y[4], translation_z[4];
+	float scale_x[4], scale_y[4], scale_z[4];
+};
+
+class AnimationClip
+{
+public:
+	AnimationClip();
+	AnimationClip(const AnimationClip&);
+	~AnimationClip();
+
+	// Compress a clip from raw keyframes laid out frame by frame ([frame * joint_count + joint]).
+	// Keys that linear interpolation reproduces within the tolerance are dropped.
+	bool Initialize(unsigned int, unsigned int, float, const XMFLOAT4*, const XMFLOAT3*, const XMFLOAT3*, float);
+	void Shutdown();
+
+	// Sample the local pose at the given time (seconds, looping) into the joint groups.
+	void Sample(float, JointGroup*) const;
+
+	unsigned int GetJointCount() const;
+	unsigned int GetKeyCount() const;
+	float GetDuration() const;
+
+private:
+	struct Track
+	{
+		unsigned int first_key;
+		unsigned int key_count;
+		XMFLOAT3 minimum;
+		XMFLOAT3 step;
+	};
+
+	void AddRotationTrack(const XMFLOAT4*, unsigned int, float);
+	void AddVectorTrack(const XMFLOAT3*, unsigned int, float, std::vector<Track>&);
+	void FindKeys(const Track&, float, unsigned int&, unsigned int&, float&) const;
+
+private:
+	unsigned int joint_count_;
+	unsigned int frame_count_;
+	float frame_rate_;
+	std::vector<Track> rotation_tracks_;
+	std::vector<Track> translation_tracks_;
+	std::vector<Track> scale_tracks_;
+	std::vector<unsigned short> key_frames_;
+	std::vector<unsigned short> key_values_;
+};
+
+// Blend two poses with a weight in [0, 1] using shortest path normalized quaternion interpolation.
+void BlendPoses(const JointGroup*, const JointGroup*, float, unsigned int, JointGroup*);
+
+class Animation
+{
+public:
+	Animation();
+	Animation(const Animation&);
+	~Animation();
+
+	bool Initialize(Direct3D*, JobSystem*);
+	void Shutdown();
+
+	// Add a character blending between two clips. Returns the character index or -1 on failure.
+	int AddCharacter(const Skeleton*, const AnimationClip*, const AnimationClip*);
+	void SetBlendWeight(unsigned int, float);
+	void SetPlaybackRate(unsigned int, float);
+
+	// Advance, sample and blend every character then build their skinning palettes.
+	void Frame(float);
+
+	// Upload a character's skinning palette and bind it to the vertex shader.
+	bool SetPalette(Direct3D*, unsigned int);
+
+	unsigned int GetCharacterCount();
+
+private:
+	struct Character
+	{
+		const Skeleton* skeleton;
+		const AnimationClip* clip_a;
+		const AnimationClip* clip_b;
+		float phase;
+		float playback_rate;
+		float blend_weight;
+		std::vector<JointGroup> pose_a;
+		std::vector<JointGroup> pose_b;
+		std::vector<JointGroup> pose;
+		std::vector<XMFLOAT4X4> model_matrices;
+		std::vector<XMFLOAT4X4> palette;
+	};
+
+	void UpdateCharacter(Character&, float);
+
+private:
+	JobSystem* job_system_;
+	ID3D11Buffer* palette_buffer_;
+	std::vector<Character> characters_;
+};
@@ -0,0 +1,170 @@
+#include "batchMath.h"
+
+#include <emmintrin.h>
+#include "batchMathKernels.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace
+{
+
+// Four lanes with SSE2, which every x64 CPU has. Used when the CPU or OS does not support anything wider.
+struct SseLanes
+{
+	typedef __m128 Type;
+	static const unsigned int WIDTH = 4;
+
+	static Type Load(const float* source) { return _mm_loadu_ps(source); }
+	static void Store(float* destination, Type value) { _mm_storeu_ps(destination, value); }
+	static Type Set(float value) { return _mm_set1_ps(value); }
+	static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+	static Type Subtract(Type a, Type b) { return _mm_sub_ps(a, b); }
+	static Type Multiply(Type a, Type b) { return _mm_mul_ps(a, b); }
+	static Type MultiplyAdd(Type a, Type b, Type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	static Type Abs(Type a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static void LeaveVectorCode() {}
+};
+
+}
+
+extern const BatchKernels kSseBatchKernels = BATCH_KERNEL_TABLE(SseLanes);
+
+static void Cpuid(int leaf, int subleaf, unsigned int registers[4])
+{
+#ifdef _MSC_VER
+	int values[4];
+	__cpuidex(values, leaf, subleaf);
+	for (int i = 0; i < 4; i++)
+		registers[i] = static_cast<unsigned int>(values[i]);
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+static unsigned long long ReadExtendedControlRegister()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int low, high;
+	__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return (static_cast<unsigned long long>(high) << 32) | low;
+#endif
+}
+
+static BatchInstructionSet DetectInstructionSet()
+{
+	unsigned int registers[4];
+
+	Cpuid(0, 0, registers);
+	unsigned int highest_leaf = registers[0];
+	if (highest_leaf < 7)
+		return BATCH_INSTRUCTION_SET_SSE;
+
+	// AVX needs the OS to save the wider registers on a context switch, which it reports through XCR0.
+	Cpuid(1, 0, registers);
+	bool os_saves_registers = (registers[2] & (1u << 27)) != 0;
+	bool avx = (registers[2] & (1u << 28)) != 0;
+	bool fma = (registers[2] & (1u << 12)) != 0;
+	if (!os_saves_registers || !avx)
+		return BATCH_INSTRUCTION_SET_SSE;
+
+	unsigned long long enabled_state = ReadExtendedControlRegister();
+	bool ymm_state = (enabled_state & 0x06) == 0x06;
+	bool zmm_state = (enabled_state & 0xe6) == 0xe6;
+
+	Cpuid(7, 0, registers);
+	bool avx2 = (registers[1] & (1u << 5)) != 0;
+	bool avx512f = (registers[1] & (1u << 16)) != 0;
+
+	if (avx512f && avx2 && fma && zmm_state)
+		return BATCH_INSTRUCTION_SET_AVX512;
+
+	if (avx2 && fma && ymm_state)
+		return BATCH_INSTRUCTION_SET_AVX2;
+
+	return BATCH_INSTRUCTION_SET_SSE;
+}
+
+static const BatchKernels& SelectKernels()
+{
+	switch (GetBatchInstructionSet())
+	{
+	case BATCH_INSTRUCTION_SET_AVX512:
+		return kAvx512BatchKernels;
+	case BATCH_INSTRUCTION_SET_AVX2:
+		return kAvx2BatchKernels;
+	default:
+		return kSseBatchKernels;
+	}
+}
+
+static const BatchKernels& Kernels()
+{
+	// Chosen once on first use; every call after that is an indirect call through the table.
+	static const BatchKernels& kernels = SelectKernels();
+	return kernels;
+}
+
+BatchInstructionSet GetBatchInstructionSet()
+{
+	static const BatchInstructionSet instruction_set = DetectInstructionSet();
+	return instruction_set;
+}
+
+const char* GetBatchInstructionSetName()
+{
+	switch (GetBatchInstructionSet())
+	{
+	case BATCH_INSTRUCTION_SET_AVX512:
+		return "AVX-512";
+	case BATCH_INSTRUCTION_SET_AVX2:
+		return "AVX2";
+	default:
+		return "SSE";
+	}
+}
+
+void BatchMultiplyMatrices(const MatrixSoA& a, const MatrixSoA& b, MatrixSoA& result, unsigned int count)
+{
+	Kernels().multiply_matrices(a, b, result, count);
+}
+
+void BatchTransformPoints(const MatrixSoA& matrices, const Float3SoA& points, Float3SoA& result, unsigned int count)
+{
+	Kernels().transform_points(matrices, points, result, count);
+}
+
+void BatchTransformPoints(const XMFLOAT4X4& matrix, const Float3SoA& points, Float3SoA& result, unsigned int count)
+{
+	Kernels().transform_points_by(&matrix._11, points, result, count);
+}
+
+void BatchTransformVectors(const MatrixSoA& matrices, const Float3SoA& vectors, Float3SoA& result, unsigned int count)
+{
+	Kernels().transform_vectors(matrices, vectors, result, count);
+}
+
+void BatchTransformVectors(const XMFLOAT4X4& matrix, const Float3SoA& vectors, Float3SoA& result, unsigned int count)
+{
+	Kernels().transform_vectors_by(&matrix._11, vectors, result, count);
+}
+
+void BatchTransformBoxes(const MatrixSoA& matrices, const BoxSoA& boxes, BoxSoA& result, unsigned int count)
+{
+	Kernels().transform_boxes(matrices, boxes, result, count);
+}
+
+void BatchTransformBoxes(const XMFLOAT4X4& matrix, const BoxSoA& boxes, BoxSoA& result, unsigned int count)
+{
+	Kernels().transform_boxes_by(&matrix._11, boxes, result, count);
+}
+
+void BatchQuaternionsToMatrices(const QuaternionSoA& rotations, MatrixSoA& result, unsigned int count)
+{
+	Kernels().quaternions_to_matrices(rotations, result, count);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "batchMathTypes.h"
+using namespace DirectX;
+
+// Batched transform math over structure-of-arrays data. Each component lives in its own array, so a kernel processes
+// 4, 8 or 16 transforms per instruction depending on the instruction set picked for the CPU at runtime.
+// Conventions match DirectXMath: row vectors, element (row, column) of matrix i is m[row * 4 + column][i].
+// Arrays need no padding or alignment; elements past the last whole vector are processed one at a time.
+
+enum BatchInstructionSet
+{
+	BATCH_INSTRUCTION_SET_SSE,
+	BATCH_INSTRUCTION_SET_AVX2,
+	BATCH_INSTRUCTION_SET_AVX512
+};
+
+// The instruction set the batch kernels run with on this CPU.
+BatchInstructionSet GetBatchInstructionSet();
+const char* GetBatchInstructionSetName();
+
+// result[i] = a[i] * b[i]. The result may share storage with either input.
+void BatchMultiplyMatrices(const MatrixSoA&, const MatrixSoA&, MatrixSoA&, unsigned int);
+
+// Transform points (w = 1) or vectors (w = 0) by a matrix each, or all by the same matrix. Affine: no divide by w.
+void BatchTransformPoints(const MatrixSoA&, const Float3SoA&, Float3SoA&, unsigned int);
+void BatchTransformPoints(const XMFLOAT4X4&, const Float3SoA&, Float3SoA&, unsigned int);
+void BatchTransformVectors(const MatrixSoA&, const Float3SoA&, Float3SoA&, unsigned int);
+void BatchTransformVectors(const XMFLOAT4X4&, const Float3SoA&, Float3SoA&, unsigned int);
+
+// Transform axis aligned boxes and return the axis aligned boxes that enclose the results.
+void BatchTransformBoxes(const MatrixSoA&, const BoxSoA&, BoxSoA&, unsigned int);
+void BatchTransformBoxes(const XMFLOAT4X4&, const BoxSoA&, BoxSoA&, unsigned int);
+
+// Build rotation matrices from unit quaternions, matching XMMatrixRotationQuaternion.
+void BatchQuaternionsToMatrices(const QuaternionSoA&, MatrixSoA&, unsigned int);
@@ -0,0 +1,33 @@
+#include "batchMathKernels.h"
+
+#include <immintrin.h>
+
+// Built with AVX2 and FMA enabled on x64 (see Engine.vcxproj and CMakeLists.txt); 32-bit MSVC builds rely on the
+// intrinsics being accepted without the flag. Only called after batchMath.cpp has checked the CPU supports both, so
+// nothing in this file may run before that.
+
+namespace
+{
+
+// Eight lanes with fused multiply-add.
+struct Avx2Lanes
+{
+	typedef __m256 Type;
+	static const unsigned int WIDTH = 8;
+
+	static Type Load(const float* source) { return _mm256_loadu_ps(source); }
+	static void Store(float* destination, Type value) { _mm256_storeu_ps(destination, value); }
+	static Type Set(float value) { return _mm256_set1_ps(value); }
+	static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+	static Type Subtract(Type a, Type b) { return _mm256_sub_ps(a, b); }
+	static Type Multiply(Type a, Type b) { return _mm256_mul_ps(a, b); }
+	static Type MultiplyAdd(Type a, Type b, Type c) { return _mm256_fmadd_ps(a, b, c); }
+	static Type Abs(Type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+	// Clear the upper halves of the registers so SSE code compiled without VEX encoding does not pay a transition penalty.
+	static void LeaveVectorCode() { _mm256_zeroupper(); }
+};
+
+}
+
+extern const BatchKernels kAvx2BatchKernels = BATCH_KERNEL_TABLE(Avx2Lanes);
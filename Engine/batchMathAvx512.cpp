@@ -0,0 +1,32 @@
+#include "batchMathKernels.h"
+
+#include <immintrin.h>
+
+// Built with AVX-512F enabled (see CMakeLists.txt; MSVC accepts the intrinsics without a flag). Only called after
+// batchMath.cpp has checked the CPU and OS support it, so nothing in this file may run before that.
+
+namespace
+{
+
+// Sixteen lanes with fused multiply-add.
+struct Avx512Lanes
+{
+	typedef __m512 Type;
+	static const unsigned int WIDTH = 16;
+
+	static Type Load(const float* source) { return _mm512_loadu_ps(source); }
+	static void Store(float* destination, Type value) { _mm512_storeu_ps(destination, value); }
+	static Type Set(float value) { return _mm512_set1_ps(value); }
+	static Type Add(Type a, Type b) { return _mm512_add_ps(a, b); }
+	static Type Subtract(Type a, Type b) { return _mm512_sub_ps(a, b); }
+	static Type Multiply(Type a, Type b) { return _mm512_mul_ps(a, b); }
+	static Type MultiplyAdd(Type a, Type b, Type c) { return _mm512_fmadd_ps(a, b, c); }
+	static Type Abs(Type a) { return _mm512_abs_ps(a); }
+
+	// Clear the upper register state so SSE code compiled without VEX encoding does not pay a transition penalty.
+	static void LeaveVectorCode() { _mm256_zeroupper(); }
+};
+
+}
+
+extern const BatchKernels kAvx512BatchKernels = BATCH_KERNEL_TABLE(Avx512Lanes);
@@ -0,0 +1,289 @@
+#pragma once
+
+#include "batchMathTypes.h"
+
+// Kernel bodies shared by every instruction set. Each is written against a lane type W that provides:
+//   Type, WIDTH, Load, Store, Set, Add, Subtract, Multiply, MultiplyAdd (a * b + c), Abs.
+// batchMath.cpp, batchMathAvx2.cpp and batchMathAvx512.cpp include this with their own lane types and compile flags.
+// It includes nothing but the plain SoA types: the AVX2 and AVX-512 files are built with wider instruction sets, and
+// any inline function they shared with the rest of the engine (DirectXMath, <cmath>) could be emitted there with those
+// instructions and then picked by the linker for callers running on CPUs without them.
+// Single matrices are passed as their 16 elements in row major order, as laid out by XMFLOAT4X4.
+
+// A table of the kernels built for one instruction set.
+struct BatchKernels
+{
+	void (*multiply_matrices)(const MatrixSoA&, const MatrixSoA&, MatrixSoA&, unsigned int);
+	void (*transform_points)(const MatrixSoA&, const Float3SoA&, Float3SoA&, unsigned int);
+	void (*transform_points_by)(const float*, const Float3SoA&, Float3SoA&, unsigned int);
+	void (*transform_vectors)(const MatrixSoA&, const Float3SoA&, Float3SoA&, unsigned int);
+	void (*transform_vectors_by)(const float*, const Float3SoA&, Float3SoA&, unsigned int);
+	void (*transform_boxes)(const MatrixSoA&, const BoxSoA&, BoxSoA&, unsigned int);
+	void (*transform_boxes_by)(const float*, const BoxSoA&, BoxSoA&, unsigned int);
+	void (*quaternions_to_matrices)(const QuaternionSoA&, MatrixSoA&, unsigned int);
+};
+
+extern const BatchKernels kSseBatchKernels;
+extern const BatchKernels kAvx2BatchKernels;
+extern const BatchKernels kAvx512BatchKernels;
+
+// Everything below is compiled separately with each instruction set's flags. Internal linkage keeps the linker from
+// merging, say, the AVX-512 build of a scalar tail loop into the SSE kernels.
+namespace
+{
+
+// One lane at a time, used for the elements left over after the last whole vector.
+struct ScalarLanes
+{
+	typedef float Type;
+	static const unsigned int WIDTH = 1;
+
+	static Type Load(const float* source) { return *source; }
+	static void Store(float* destination, Type value) { *destination = value; }
+	static Type Set(float value) { return value; }
+	static Type Add(Type a, Type b) { return a + b; }
+	static Type Subtract(Type a, Type b) { return a - b; }
+	static Type Multiply(Type a, Type b) { return a * b; }
+	static Type MultiplyAdd(Type a, Type b, Type c) { return a * b + c; }
+	static Type Abs(Type a) { return a < 0.0f ? -a : a; }
+};
+
+// Matrix elements read from a stream, one matrix per lane.
+template <typename W>
+struct StreamMatrix
+{
+	const MatrixSoA& matrices;
+
+	explicit StreamMatrix(const MatrixSoA& source) : matrices(source) {}
+	typename W::Type Get(int element, unsigned int index) const { return W::Load(matrices.m[element] + index); }
+};
+
+// The same matrix broadcast to every lane.
+template <typename W>
+struct ConstantMatrix
+{
+	typename W::Type elements[16];
+
+	explicit ConstantMatrix(const float* matrix)
+	{
+		for (int element = 0; element < 16; element++)
+			elements[element] = W::Set(matrix[element]);
+	}
+	typename W::Type Get(int element, unsigned int) const { return elements[element]; }
+};
+
+template <typename W>
+void MultiplyMatricesRange(const MatrixSoA& a, const MatrixSoA& b, MatrixSoA& result, unsigned int begin, unsigned int end)
+{
+	typedef typename W::Type V;
+
+	for (unsigned int i = begin; i < end; i += W::WIDTH)
+	{
+		// Load all of b and each row of a before writing that row, so the result can overwrite either input.
+		V columns[16];
+		for (int element = 0; element < 16; element++)
+			columns[element] = W::Load(b.m[element] + i);
+
+		for (int row = 0; row < 4; row++)
+		{
+			V a0 = W::Load(a.m[row * 4 + 0] + i);
+			V a1 = W::Load(a.m[row * 4 + 1] + i);
+			V a2 = W::Load(a.m[row * 4 + 2] + i);
+			V a3 = W::Load(a.m[row * 4 + 3] + i);
+
+			for (int column = 0; column < 4; column++)
+			{
+				V value = W::Multiply(a0, columns[column]);
+				value = W::MultiplyAdd(a1, columns[4 + column], value);
+				value = W::MultiplyAdd(a2, columns[8 + column], value);
+				value = W::MultiplyAdd(a3, columns[12 + column], value);
+				W::Store(result.m[row * 4 + column] + i, value);
+			}
+		}
+	}
+}
+
+template <typename W, typename M>
+void TransformRange(const M& matrix, const Float3SoA& source, Float3SoA& result, bool translate, unsigned int begin, unsigned int end)
+{
+	typedef typename W::Type V;
+
+	for (unsigned int i = begin; i < end; i += W::WIDTH)
+	{
+		V x = W::Load(source.x + i);
+		V y = W::Load(source.y + i);
+		V z = W::Load(source.z + i);
+
+		for (int column = 0; column < 3; column++)
+		{
+			V value = translate ? matrix.Get(12 + column, i) : W::Set(0.0f);
+			value = W::MultiplyAdd(x, matrix.Get(column, i), value);
+			value = W::MultiplyAdd(y, matrix.Get(4 + column, i), value);
+			value = W::MultiplyAdd(z, matrix.Get(8 + column, i), value);
+			W::Store((&result.x)[column] + i, value);
+		}
+	}
+}
+
+template <typename W, typename M>
+void TransformBoxesRange(const M& matrix, const BoxSoA& source, BoxSoA& result, unsigned int begin, unsigned int end)
+{
+	typedef typename W::Type V;
+
+	V half = W::Set(0.5f);
+	for (unsigned int i = begin; i < end; i += W::WIDTH)
+	{
+		// Work with the centre and half extents: the centre transforms as a point and each new extent is the sum of
+		// the old extents weighted by the absolute matrix elements.
+		V centre[3], extent[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			V minimum = W::Load((&source.minimum.x)[axis] + i);
+			V maximum = W::Load((&source.maximum.x)[axis] + i);
+			centre[axis] = W::Multiply(W::Add(minimum, maximum), half);
+			extent[axis] = W::Multiply(W::Subtract(maximum, minimum), half);
+		}
+
+		for (int column = 0; column < 3; column++)
+		{
+			V new_centre = matrix.Get(12 + column, i);
+			V new_extent = W::Set(0.0f);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				V element = matrix.Get(axis * 4 + column, i);
+				new_centre = W::MultiplyAdd(centre[axis], element, new_centre);
+				new_extent = W::MultiplyAdd(extent[axis], W::Abs(element), new_extent);
+			}
+
+			W::Store((&result.minimum.x)[column] + i, W::Subtract(new_centre, new_extent));
+			W::Store((&result.maximum.x)[column] + i, W::Add(new_centre, new_extent));
+		}
+	}
+}
+
+template <typename W>
+void QuaternionsToMatricesRange(const QuaternionSoA& rotations, MatrixSoA& result, unsigned int begin, unsigned int end)
+{
+	typedef typename W::Type V;
+
+	V one = W::Set(1.0f);
+	V two = W::Set(2.0f);
+	V zero = W::Set(0.0f);
+	for (unsigned int i = begin; i < end; i += W::WIDTH)
+	{
+		V x = W::Load(rotations.x + i);
+		V y = W::Load(rotations.y + i);
+		V z = W::Load(rotations.z + i);
+		V w = W::Load(rotations.w + i);
+
+		V x2 = W::Multiply(x, two);
+		V y2 = W::Multiply(y, two);
+		V z2 = W::Multiply(z, two);
+		V xx = W::Multiply(x, x2), yy = W::Multiply(y, y2), zz = W::Multiply(z, z2);
+		V xy = W::Multiply(x, y2), xz = W::Multiply(x, z2), yz = W::Multiply(y, z2);
+		V wx = W::Multiply(w, x2), wy = W::Multiply(w, y2), wz = W::Multiply(w, z2);
+
+		W::Store(result.m[0] + i, W::Subtract(one, W::Add(yy, zz)));
+		W::Store(result.m[1] + i, W::Add(xy, wz));
+		W::Store(result.m[2] + i, W::Subtract(xz, wy));
+		W::Store(result.m[3] + i, zero);
+		W::Store(result.m[4] + i, W::Subtract(xy, wz));
+		W::Store(result.m[5] + i, W::Subtract(one, W::Add(xx, zz)));
+		W::Store(result.m[6] + i, W::Add(yz, wx));
+		W::Store(result.m[7] + i, zero);
+		W::Store(result.m[8] + i, W::Add(xz, wy));
+		W::Store(result.m[9] + i, W::Subtract(yz, wx));
+		W::Store(result.m[10] + i, W::Subtract(one, W::Add(xx, yy)));
+		W::Store(result.m[11] + i, zero);
+		W::Store(result.m[12] + i, zero);
+		W::Store(result.m[13] + i, zero);
+		W::Store(result.m[14] + i, zero);
+		W::Store(result.m[15] + i, one);
+	}
+}
+
+// Entry points for one instruction set: whole vectors with W, then the remainder one lane at a time.
+// LeaveVectorCode is called before returning so wide kernels can clear the upper register state.
+template <typename W>
+struct BatchKernelSet
+{
+	static unsigned int WholeVectors(unsigned int count)
+	{
+		return count - count % W::WIDTH;
+	}
+
+	static void MultiplyMatrices(const MatrixSoA& a, const MatrixSoA& b, MatrixSoA& result, unsigned int count)
+	{
+		unsigned int split = WholeVectors(count);
+		MultiplyMatricesRange<W>(a, b, result, 0, split);
+		W::LeaveVectorCode();
+		MultiplyMatricesRange<ScalarLanes>(a, b, result, split, count);
+	}
+
+	static void TransformPoints(const MatrixSoA& matrices, const Float3SoA& source, Float3SoA& result, unsigned int count)
+	{
+		unsigned int split = WholeVectors(count);
+		TransformRange<W>(StreamMatrix<W>(matrices), source, result, true, 0, split);
+		W::LeaveVectorCode();
+		TransformRange<ScalarLanes>(StreamMatrix<ScalarLanes>(matrices), source, result, true, split, count);
+	}
+
+	static void TransformPointsBy(const float* matrix, const Float3SoA& source, Float3SoA& result, unsigned int count)
+	{
+		unsigned int split = WholeVectors(count);
+		TransformRange<W>(ConstantMatrix<W>(matrix), source, result, true, 0, split);
+		W::LeaveVectorCode();
+		TransformRange<ScalarLanes>(ConstantMatrix<ScalarLanes>(matrix), source, result, true, split, count);
+	}
+
+	static void TransformVectors(const MatrixSoA& matrices, const Float3SoA& source, Float3SoA& result, unsigned int count)
+	{
+		unsigned int split = WholeVectors(count);
+		TransformRange<W>(StreamMatrix<W>(matrices), source, result, false, 0, split);
+		W::LeaveVectorCode();
+		TransformRange<ScalarLanes>(StreamMatrix<ScalarLanes>(matrices), source, result, false, split, count);
+	}
+
+	static void TransformVectorsBy(const float* matrix, const Float3SoA& source, Float3SoA& result, unsigned int count)
+	{
+		unsigned int split = WholeVectors(count);
+		TransformRange<W>(ConstantMatrix<W>(matrix), source, result, false, 0, split);
+		W::LeaveVectorCode();
+		TransformRange<ScalarLanes>(ConstantMatrix<ScalarLanes>(matrix), source, result, false, split, count);
+	}
+
+	static void TransformBoxes(const MatrixSoA& matrices, const BoxSoA& source, BoxSoA& result, unsigned int count)
+	{
+		unsigned int split = WholeVectors(count);
+		TransformBoxesRange<W>(StreamMatrix<W>(matrices), source, result, 0, split);
+		W::LeaveVectorCode();
+		TransformBoxesRange<ScalarLanes>(StreamMatrix<ScalarLanes>(matrices), source, result, split, count);
+	}
+
+	static void TransformBoxesBy(const float* matrix, const BoxSoA& source, BoxSoA& result, unsigned int count)
+	{
+		unsigned int split = WholeVectors(count);
+		TransformBoxesRange<W>(ConstantMatrix<W>(matrix), source, result, 0, split);
+		W::LeaveVectorCode();
+		TransformBoxesRange<ScalarLanes>(ConstantMatrix<ScalarLanes>(matrix), source, result, split, count);
+	}
+
+	static void QuaternionsToMatrices(const QuaternionSoA& rotations, MatrixSoA& result, unsigned int count)
+	{
+		unsigned int split = WholeVectors(count);
+		QuaternionsToMatricesRange<W>(rotations, result, 0, split);
+		W::LeaveVectorCode();
+		QuaternionsToMatricesRange<ScalarLanes>(rotations, result, split, count);
+	}
+};
+
+}
+
+// Fill a BatchKernels table from the entry points built with lane type W; a constant initializer, so the tables are
+// ready before any static constructor could ask for them.
+#define BATCH_KERNEL_TABLE(W) \
+	{ \
+		BatchKernelSet<W>::MultiplyMatrices, BatchKernelSet<W>::TransformPoints, BatchKernelSet<W>::TransformPointsBy, \
+		BatchKernelSet<W>::TransformVectors, BatchKernelSet<W>::TransformVectorsBy, BatchKernelSet<W>::TransformBoxes, \
+		BatchKernelSet<W>::TransformBoxesBy, BatchKernelSet<W>::QuaternionsToMatrices \
+	}
@@ -0,0 +1,30 @@
+#pragma once
+
+// Structure of arrays views used by the batch math kernels (see batchMath.h). Plain data with no includes, so the
+// instruction set specific kernel files can use them without pulling in DirectXMath.
+
+struct MatrixSoA
+{
+	float* m[16];
+};
+
+struct Float3SoA
+{
+	float* x;
+	float* y;
+	float* z;
+};
+
+struct QuaternionSoA
+{
+	float* x;
+	float* y;
+	float* z;
+	float* w;
+};
+
+struct BoxSoA
+{
+	Float3SoA minimum;
+	Float3SoA maximum;
+};
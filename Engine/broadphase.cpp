@@ -0,0 +1,316 @@
+#include "broadphase.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <xmmintrin.h>
+#include "jobSystem.h"
+
+// Sentinel boxes appended to the sorted bounds so a four wide load starting at the last proxy stays in range.
+static const unsigned int SIMD_PADDING = 4;
+
+// The sort axis only changes when another axis spreads the proxies out by this much more, to avoid flip-flopping.
+static const float AXIS_SWITCH_RATIO = 1.25f;
+
+static float Component(const XMFLOAT3& vector, int axis)
+{
+	return (&vector.x)[axis];
+}
+
+static bool ComparePairs(const BroadphasePair& a, const BroadphasePair& b)
+{
+	return a.proxy_a < b.proxy_a || (a.proxy_a == b.proxy_a && a.proxy_b < b.proxy_b);
+}
+
+static bool EqualPairs(const BroadphasePair& a, const BroadphasePair& b)
+{
+	return a.proxy_a == b.proxy_a && a.proxy_b == b.proxy_b;
+}
+
+Broadphase::Broadphase() :
+	job_system_(0),
+	sorted_count_(0),
+	sort_axis_(0)
+{
+}
+
+Broadphase::Broadphase(const Broadphase& kOther)
+{
+}
+
+Broadphase::~Broadphase()
+{
+}
+
+bool Broadphase::Initialize(JobSystem* job_system)
+{
+	// Store the job system used to generate pairs in parallel.
+	job_system_ = job_system;
+	sorted_count_ = 0;
+	sort_axis_ = 0;
+
+	return true;
+}
+
+void Broadphase::Shutdown()
+{
+	minimums_.clear();
+	maximums_.clear();
+	alive_.clear();
+	free_proxies_.clear();
+	sorted_proxies_.clear();
+	sorted_count_ = 0;
+	job_pairs_.clear();
+	pairs_.clear();
+	job_system_ = 0;
+}
+
+unsigned int Broadphase::CreateProxy(const XMFLOAT3& minimum, const XMFLOAT3& maximum)
+{
+	// Reuse a destroyed proxy id where possible.
+	unsigned int proxy;
+	if (!free_proxies_.empty())
+	{
+		proxy = free_proxies_.back();
+		free_proxies_.pop_back();
+		minimums_[proxy] = minimum;
+		maximums_[proxy] = maximum;
+		alive_[proxy] = true;
+	}
+	else
+	{
+		proxy = static_cast<unsigned int>(minimums_.size());
+		minimums_.push_back(minimum);
+		maximums_.push_back(maximum);
+		alive_.push_back(true);
+	}
+
+	// The next sort moves the new proxy into place.
+	sorted_proxies_.push_back(proxy);
+	return proxy;
+}
+
+void Broadphase::UpdateProxy(unsigned int proxy, const XMFLOAT3& minimum, const XMFLOAT3& maximum)
+{
+	minimums_[proxy] = minimum;
+	maximums_[proxy] = maximum;
+}
+
+void Broadphase::DestroyProxy(unsigned int proxy)
+{
+	if (proxy >= alive_.size() || !alive_[proxy])
+		return;
+
+	// Remove the proxy from the sorted order and release its id.
+	std::vector<unsigned int>::iterator position = std::find(sorted_proxies_.begin(), sorted_proxies_.end(), proxy);
+	if (static_cast<size_t>(position - sorted_proxies_.begin()) < sorted_count_)
+		sorted_count_--;
+
+	sorted_proxies_.erase(position);
+	alive_[proxy] = false;
+	free_proxies_.push_back(proxy);
+}
+
+void Broadphase::Frame()
+{
+	// Pick the axis that separates the proxies best, then restore the sorted order along it.
+	bool axis_changed = ChooseSortAxis();
+	SortProxies(axis_changed);
+	GatherSortedBounds();
+
+	// Scan the sorted proxies in batches, each batch writing to its own pair list.
+	unsigned int proxy_count = static_cast<unsigned int>(sorted_proxies_.size());
+	unsigned int job_count = (proxy_count + PROXIES_PER_JOB - 1) / PROXIES_PER_JOB;
+	if (job_pairs_.size() < job_count)
+		job_pairs_.resize(job_count);
+
+	auto find_pairs = [this](unsigned int begin, unsigned int end)
+	{
+		std::vector<BroadphasePair>& pairs = job_pairs_[begin / PROXIES_PER_JOB];
+		pairs.clear();
+		FindPairs(begin, end, pairs);
+	};
+
+	if (job_system_)
+	{
+		job_system_->Dispatch(proxy_count, PROXIES_PER_JOB, find_pairs);
+	}
+	else
+	{
+		for (unsigned int begin = 0; begin < proxy_count; begin += PROXIES_PER_JOB)
+			find_pairs(begin, (std::min)(begin + PROXIES_PER_JOB, proxy_count));
+	}
+
+	// Merge the batches into a single list in a stable order, dropping any duplicates.
+	pairs_.clear();
+	for (unsigned int i = 0; i < job_count; i++)
+		pairs_.insert(pairs_.end(), job_pairs_[i].begin(), job_pairs_[i].end());
+
+	std::sort(pairs_.begin(), pairs_.end(), ComparePairs);
+	pairs_.erase(std::unique(pairs_.begin(), pairs_.end(), EqualPairs), pairs_.end());
+}
+
+const std::vector<BroadphasePair>& Broadphase::GetPairs()
+{
+	return pairs_;
+}
+
+bool Broadphase::ChooseSortAxis()
+{
+	if (sorted_proxies_.size() < 2)
+		return false;
+
+	// Measure the variance of the box centres along each axis.
+	float sum[3] { 0.0f, 0.0f, 0.0f };
+	float sum_squared[3] { 0.0f, 0.0f, 0.0f };
+	for (unsigned int proxy : sorted_proxies_)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float centre = (Component(minimums_[proxy], axis) + Component(maximums_[proxy], axis)) * 0.5f;
+			sum[axis] += centre;
+			sum_squared[axis] += centre * centre;
+		}
+	}
+
+	float count = static_cast<float>(sorted_proxies_.size());
+	float variance[3];
+	int best_axis = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		variance[axis] = sum_squared[axis] / count - (sum[axis] / count) * (sum[axis] / count);
+		if (variance[axis] > variance[best_axis])
+			best_axis = axis;
+	}
+
+	// Only switch when the new axis is clearly better, as a switch forces a full sort.
+	if (best_axis == sort_axis_ || variance[best_axis] < variance[sort_axis_] * AXIS_SWITCH_RATIO)
+		return false;
+
+	sort_axis_ = best_axis;
+	return true;
+}
+
+void Broadphase::SortProxies(bool full_sort)
+{
+	const int axis = sort_axis_;
+	auto less = [this, axis](unsigned int a, unsigned int b)
+	{
+		return Component(minimums_[a], axis) < Component(minimums_[b], axis);
+	};
+
+	if (full_sort)
+	{
+		std::sort(sorted_proxies_.begin(), sorted_proxies_.end(), less);
+		sorted_count_ = sorted_proxies_.size();
+		return;
+	}
+
+	// Insertion sort from last frame's order. Objects move little between frames so few proxies travel far.
+	for (size_t i = 1; i < sorted_count_; i++)
+	{
+		unsigned int proxy = sorted_proxies_[i];
+		float key = Component(minimums_[proxy], axis);
+
+		size_t j = i;
+		while (j > 0 && Component(minimums_[sorted_proxies_[j - 1]], axis) > key)
+		{
+			sorted_proxies_[j] = sorted_proxies_[j - 1];
+			j--;
+		}
+		sorted_proxies_[j] = proxy;
+	}
+
+	// Sort the proxies created since the last frame on their own and merge them in.
+	if (sorted_count_ < sorted_proxies_.size())
+	{
+		std::vector<unsigned int>::iterator middle = sorted_proxies_.begin() + sorted_count_;
+		std::sort(middle, sorted_proxies_.end(), less);
+		std::inplace_merge(sorted_proxies_.begin(), middle, sorted_proxies_.end(), less);
+		sorted_count_ = sorted_proxies_.size();
+	}
+}
+
+void Broadphase::GatherSortedBounds()
+{
+	const int axis = sort_axis_;
+	const int other_axes[2] { (axis + 1) % 3, (axis + 2) % 3 };
+
+	size_t proxy_count = sorted_proxies_.size();
+	sort_minimums_.resize(proxy_count + SIMD_PADDING);
+	sort_maximums_.resize(proxy_count + SIMD_PADDING);
+	for (int i = 0; i < 2; i++)
+	{
+		other_minimums_[i].resize(proxy_count + SIMD_PADDING);
+		other_maximums_[i].resize(proxy_count + SIMD_PADDING);
+	}
+
+	// Copy each component into its own array in sorted order.
+	for (size_t i = 0; i < proxy_count; i++)
+	{
+		unsigned int proxy = sorted_proxies_[i];
+		sort_minimums_[i] = Component(minimums_[proxy], axis);
+		sort_maximums_[i] = Component(maximums_[proxy], axis);
+		for (int k = 0; k < 2; k++)
+		{
+			other_minimums_[k][i] = Component(minimums_[proxy], other_axes[k]);
+			other_maximums_[k][i] = Component(maximums_[proxy], other_axes[k]);
+		}
+	}
+
+	// Pad with inverted boxes that fail every overlap test.
+	for (size_t i = proxy_count; i < proxy_count + SIMD_PADDING; i++)
+	{
+		sort_minimums_[i] = FLT_MAX;
+		sort_maximums_[i] = -FLT_MAX;
+		for (int k = 0; k < 2; k++)
+		{
+			other_minimums_[k][i] = FLT_MAX;
+			other_maximums_[k][i] = -FLT_MAX;
+		}
+	}
+}
+
+void Broadphase::FindPairs(unsigned int begin, unsigned int end, std::vector<BroadphasePair>& pairs)
+{
+	const unsigned int proxy_count = static_cast<unsigned int>(sorted_proxies_.size());
+	const float* sort_minimums = sort_minimums_.data();
+	const float* minimums_1 = other_minimums_[0].data();
+	const float* maximums_1 = other_maximums_[0].data();
+	const float* minimums_2 = other_minimums_[1].data();
+	const float* maximums_2 = other_maximums_[1].data();
+
+	for (unsigned int i = begin; i < end; i++)
+	{
+		float sort_maximum = sort_maximums_[i];
+		__m128 box_sort_maximum = _mm_set1_ps(sort_maximum);
+		__m128 box_minimum_1 = _mm_set1_ps(minimums_1[i]);
+		__m128 box_maximum_1 = _mm_set1_ps(maximums_1[i]);
+		__m128 box_minimum_2 = _mm_set1_ps(minimums_2[i]);
+		__m128 box_maximum_2 = _mm_set1_ps(maximums_2[i]);
+
+		// Every later proxy starting before this one ends on the sort axis is a candidate. Test four at a time
+		// against the other two axes.
+		for (unsigned int j = i + 1; j < proxy_count && sort_minimums[j] <= sort_maximum; j += 4)
+		{
+			__m128 overlap = _mm_cmple_ps(_mm_loadu_ps(sort_minimums + j), box_sort_maximum);
+			overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_loadu_ps(minimums_1 + j), box_maximum_1));
+			overlap = _mm_and_ps(overlap, _mm_cmpge_ps(_mm_loadu_ps(maximums_1 + j), box_minimum_1));
+			overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_loadu_ps(minimums_2 + j), box_maximum_2));
+			overlap = _mm_and_ps(overlap, _mm_cmpge_ps(_mm_loadu_ps(maximums_2 + j), box_minimum_2));
+
+			int mask = _mm_movemask_ps(overlap);
+			for (unsigned int lane = 0; mask != 0; lane++, mask >>= 1)
+			{
+				if ((mask & 1) == 0 || j + lane >= proxy_count)
+					continue;
+
+				unsigned int proxy_a = sorted_proxies_[i];
+				unsigned int proxy_b = sorted_proxies_[j + lane];
+				BroadphasePair pair;
+				pair.proxy_a = (std::min)(proxy_a, proxy_b);
+				pair.proxy_b = (std::max)(proxy_a, proxy_b);
+				pairs.push_back(pair);
+			}
+		}
+	}
+}
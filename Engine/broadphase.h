@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+using namespace DirectX;
+
+class JobSystem;
+
+// Sorted proxies scanned for pairs by a single job.
+const unsigned int PROXIES_PER_JOB = 256;
+
+// An overlapping pair of proxies, always ordered so proxy_a < proxy_b.
+struct BroadphasePair
+{
+	unsigned int proxy_a;
+	unsigned int proxy_b;
+};
+
+class Broadphase
+{
+public:
+	Broadphase();
+	Broadphase(const Broadphase&);
+	~Broadphase();
+
+	bool Initialize(JobSystem*);
+	void Shutdown();
+
+	// Add an axis aligned box (minimum, maximum) and return its proxy id.
+	unsigned int CreateProxy(const XMFLOAT3&, const XMFLOAT3&);
+	void UpdateProxy(unsigned int, const XMFLOAT3&, const XMFLOAT3&);
+	void DestroyProxy(unsigned int);
+
+	// Re-sort the proxies and rebuild the overlapping pair list.
+	void Frame();
+
+	// The sorted, duplicate free pair list built by the last frame.
+	const std::vector<BroadphasePair>& GetPairs();
+
+private:
+	bool ChooseSortAxis();
+	void SortProxies(bool);
+	void GatherSortedBounds();
+	void FindPairs(unsigned int, unsigned int, std::vector<BroadphasePair>&);
+
+private:
+	JobSystem* job_system_;
+
+	// Bounds indexed by proxy id.
+	std::vector<XMFLOAT3> minimums_;
+	std::vector<XMFLOAT3> maximums_;
+	std::vector<bool> alive_;
+	std::vector<unsigned int> free_proxies_;
+
+	// Proxy ids ordered by their minimum on the sort axis. The order carries over between frames so re-sorting
+	// coherent motion is close to linear.
+	// Proxies created since the last frame are appended after the sorted ones.
+	std::vector<unsigned int> sorted_proxies_;
+	size_t sorted_count_;
+	int sort_axis_;
+
+	// Bounds gathered into sorted order, one array per component so four candidates are tested at once.
+	// The arrays are padded with boxes that overlap nothing so the SIMD loads can run past the last proxy.
+	std::vector<float> sort_minimums_;
+	std::vector<float> sort_maximums_;
+	std::vector<float> other_minimums_[2];
+	std::vector<float> other_maximums_[2];
+
+	std::vector<std::vector<BroadphasePair>> job_pairs_;
+	std::vector<BroadphasePair> pairs_;
+};
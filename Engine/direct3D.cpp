@@ -5,7 +5,9 @@ Direct3D::Direct3D() :
 	device_(0), device_context_(0),
 	render_target_view_(0),
 	depth_stencil_buffer_(0), depth_stencil_state_(0), depth_stencil_view_(0),
-	raster_state_(0)
+	raster_state_(0),
+	depth_disabled_stencil_state_(0),
+	alpha_enable_blending_state_(0), alpha_disable_blending_state_(0)
 {
 }
 
@@ -22,6 +24,10 @@ bool Direct3D::Initialize(int screen_width, int screen_height, bool vsync, HWND
 	// Store the V-Sync setting.
 	vsync_enabled_ = vsync;
 
+	// Without a window there is nothing to present to, so create a null device for headless runs.
+	if (!window)
+		return InitializeHeadless(screen_width, screen_height, screen_depth, screen_near);
+
 	// Create a DirectX graphics interface factory.
 	IDXGIFactory* factory = nullptr;
 	if (FAILED(CreateDXGIFactory(__uuidof(IDXGIFactory), (void**)&factory)))
@@ -261,6 +267,39 @@ bool Direct3D::Initialize(int screen_width, int screen_height, bool vsync, HWND
 	// Create the viewport.
 	device_context_->RSSetViewports(1, &viewport);
 
+	// Create the projection, world and orthographic matrices.
+	InitializeMatrices(screen_width, screen_height, screen_depth, screen_near);
+
+	// Create the states 2D rendering switches to.
+	if (!InitializeRenderStates())
+		return false;
+
+	return true;
+}
+
+bool Direct3D::InitializeHeadless(int screen_width, int screen_height, float screen_depth, float screen_near)
+{
+	// Create a null device. It accepts every call but renders nothing, leaving only the CPU cost of a frame.
+	D3D_FEATURE_LEVEL feature_level = D3D_FEATURE_LEVEL_11_0;
+	if (FAILED(D3D11CreateDevice(0, D3D_DRIVER_TYPE_NULL, 0, 0, &feature_level, 1, D3D11_SDK_VERSION, &device_, 0, &device_context_)))
+		return false;
+
+	// Report the null device as the video card.
+	strcpy_s(video_card_description_, 128, "Null Device");
+	video_card_memory_ = 0;
+
+	// Create the projection, world and orthographic matrices.
+	InitializeMatrices(screen_width, screen_height, screen_depth, screen_near);
+
+	// Create the states 2D rendering switches to.
+	if (!InitializeRenderStates())
+		return false;
+
+	return true;
+}
+
+void Direct3D::InitializeMatrices(int screen_width, int screen_height, float screen_depth, float screen_near)
+{
 	// Setup the projection matrix.
 	float field_of_view = XM_PIDIV4;
 	float aspect_ratio = static_cast<float>(screen_width) / static_cast<float>(screen_height);
@@ -273,6 +312,42 @@ bool Direct3D::Initialize(int screen_width, int screen_height, bool vsync, HWND
 
 	// Create an orphographic projection matrix for 2D rendering.
 	ortho_matrix_ = XMMatrixOrthographicLH(static_cast<float>(screen_width), static_cast<float>(screen_height), screen_near, screen_depth);
+}
+
+bool Direct3D::InitializeRenderStates()
+{
+	// Setup a depth stencil state that turns off the Z buffer for 2D rendering. Stencil is unused.
+	D3D11_DEPTH_STENCIL_DESC depth_disabled_stencil_desc;
+	ZeroMemory(&depth_disabled_stencil_desc, sizeof(depth_disabled_stencil_desc));
+	depth_disabled_stencil_desc.DepthEnable = false;
+	depth_disabled_stencil_desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	depth_disabled_stencil_desc.DepthFunc = D3D11_COMPARISON_LESS;
+	depth_disabled_stencil_desc.StencilEnable = false;
+
+	// Create the depth disabled stencil state.
+	if (FAILED(device_->CreateDepthStencilState(&depth_disabled_stencil_desc, &depth_disabled_stencil_state_)))
+		return false;
+
+	// Setup a blend state that blends with the source alpha.
+	D3D11_BLEND_DESC blend_desc;
+	ZeroMemory(&blend_desc, sizeof(blend_desc));
+	blend_desc.RenderTarget[0].BlendEnable = TRUE;
+	blend_desc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+	blend_desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	blend_desc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	blend_desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	blend_desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	blend_desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	blend_desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+	// Create the alpha enabled blend state.
+	if (FAILED(device_->CreateBlendState(&blend_desc, &alpha_enable_blending_state_)))
+		return false;
+
+	// Create the alpha disabled blend state from the same description.
+	blend_desc.RenderTarget[0].BlendEnable = FALSE;
+	if (FAILED(device_->CreateBlendState(&blend_desc, &alpha_disable_blending_state_)))
+		return false;
 
 	return true;
 }
@@ -283,6 +358,24 @@ void Direct3D::Shutdown()
 	if (swap_chain_)
 		swap_chain_->SetFullscreenState(false, 0);
 
+	if (alpha_disable_blending_state_)
+	{
+		alpha_disable_blending_state_->Release();
+		alpha_disable_blending_state_ = nullptr;
+	}
+
+	if (alpha_enable_blending_state_)
+	{
+		alpha_enable_blending_state_->Release();
+		alpha_enable_blending_state_ = nullptr;
+	}
+
+	if (depth_disabled_stencil_state_)
+	{
+		depth_disabled_stencil_state_->Release();
+		depth_disabled_stencil_state_ = nullptr;
+	}
+
 	if (raster_state_)
 	{
 		raster_state_->Release();
@@ -337,6 +430,10 @@ void Direct3D::BeginScene(float red, float green, float blue, float alpha)
 	// Set the colour to clear the buffer to.
 	float colour[4] { red, green, blue, alpha };
 
+	// Headless devices have no back or depth buffer to clear.
+	if (!render_target_view_)
+		return;
+
 	// Clear the back buffer.
 	device_context_->ClearRenderTargetView(render_target_view_, colour);
 
@@ -346,6 +443,10 @@ void Direct3D::BeginScene(float red, float green, float blue, float alpha)
 
 void Direct3D::EndScene()
 {
+	// Headless devices have no swap chain and are never throttled by presentation.
+	if (!swap_chain_)
+		return;
+
 	// Present the back buffer to the screen.
 	swap_chain_->Present(static_cast<int>(vsync_enabled_), 0);
 }
@@ -380,3 +481,93 @@ void Direct3D::GetVideoCardInfo(char *card_name, int &memory)
 	strcpy_s(card_name, 128, video_card_description_);
 	memory = video_card_memory_;
 }
+
+void Direct3D::TurnZBufferOn()
+{
+	device_context_->OMSetDepthStencilState(depth_stencil_state_, 1);
+}
+
+void Direct3D::TurnZBufferOff()
+{
+	device_context_->OMSetDepthStencilState(depth_disabled_stencil_state_, 1);
+}
+
+void Direct3D::TurnOnAlphaBlending()
+{
+	float blend_factor[4] { 0.0f, 0.0f, 0.0f, 0.0f };
+	device_context_->OMSetBlendState(alpha_enable_blending_state_, blend_factor, 0xffffffff);
+}
+
+void Direct3D::TurnOffAlphaBlending()
+{
+	float blend_factor[4] { 0.0f, 0.0f, 0.0f, 0.0f };
+	device_context_->OMSetBlendState(alpha_disable_blending_state_, blend_factor, 0xffffffff);
+}
+
+bool Direct3D::CreateConstantBuffer(unsigned int byte_width, ID3D11Buffer **buffer)
+{
+	// Setup a dynamic constant buffer description so the CPU can rewrite the contents every frame.
+	// Constant buffers must be a multiple of 16 bytes in size.
+	D3D11_BUFFER_DESC buffer_desc;
+	buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+	buffer_desc.ByteWidth = (byte_width + 15) & ~15u;
+	buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	buffer_desc.MiscFlags = 0;
+	buffer_desc.StructureByteStride = 0;
+
+	// Create the constant buffer.
+	if (FAILED(device_->CreateBuffer(&buffer_desc, 0, buffer)))
+		return false;
+
+	return true;
+}
+
+bool Direct3D::UpdateConstantBuffer(ID3D11Buffer *buffer, const void *data, unsigned int byte_width)
+{
+	return UpdateDynamicBuffer(buffer, data, byte_width);
+}
+
+bool Direct3D::CreateStructuredBuffer(unsigned int element_size, unsigned int element_count, ID3D11Buffer **buffer, ID3D11ShaderResourceView **view)
+{
+	// Setup a dynamic structured buffer description so shaders can index an array the CPU rewrites every frame.
+	D3D11_BUFFER_DESC buffer_desc;
+	buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+	buffer_desc.ByteWidth = element_size * element_count;
+	buffer_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	buffer_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	buffer_desc.StructureByteStride = element_size;
+
+	// Create the structured buffer.
+	if (FAILED(device_->CreateBuffer(&buffer_desc, 0, buffer)))
+		return false;
+
+	// Setup the shader resource view over every element of the buffer.
+	D3D11_SHADER_RESOURCE_VIEW_DESC view_desc;
+	ZeroMemory(&view_desc, sizeof(view_desc));
+	view_desc.Format = DXGI_FORMAT_UNKNOWN;
+	view_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	view_desc.Buffer.FirstElement = 0;
+	view_desc.Buffer.NumElements = element_count;
+
+	// Create the shader resource view.
+	if (FAILED(device_->CreateShaderResourceView(*buffer, &view_desc, view)))
+		return false;
+
+	return true;
+}
+
+bool Direct3D::UpdateDynamicBuffer(ID3D11Buffer *buffer, const void *data, unsigned int byte_width)
+{
+	// Lock the buffer, discarding the previous contents so the GPU is not stalled.
+	D3D11_MAPPED_SUBRESOURCE mapped_resource;
+	if (FAILED(device_context_->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped_resource)))
+		return false;
+
+	// Copy the data into the buffer and unlock it.
+	memcpy(mapped_resource.pData, data, byte_width);
+	device_context_->Unmap(buffer, 0);
+
+	return true;
+}
@@ -30,6 +30,21 @@ public:
 
 	void GetVideoCardInfo(char*, int&);
 
+	void TurnZBufferOn();
+	void TurnZBufferOff();
+	void TurnOnAlphaBlending();
+	void TurnOffAlphaBlending();
+
+	bool CreateConstantBuffer(unsigned int, ID3D11Buffer**);
+	bool UpdateConstantBuffer(ID3D11Buffer*, const void*, unsigned int);
+	bool CreateStructuredBuffer(unsigned int, unsigned int, ID3D11Buffer**, ID3D11ShaderResourceView**);
+	bool UpdateDynamicBuffer(ID3D11Buffer*, const void*, unsigned int);
+
+private:
+	bool InitializeHeadless(int, int, float, float);
+	void InitializeMatrices(int, int, float, float);
+	bool InitializeRenderStates();
+
 private:
 	bool vsync_enabled_;
 	int video_card_memory_;
@@ -42,6 +57,9 @@ private:
 	ID3D11DepthStencilState* depth_stencil_state_;
 	ID3D11DepthStencilView* depth_stencil_view_;
 	ID3D11RasterizerState* raster_state_;
+	ID3D11DepthStencilState* depth_disabled_stencil_state_;
+	ID3D11BlendState* alpha_enable_blending_state_;
+	ID3D11BlendState* alpha_disable_blending_state_;
 	XMMATRIX projection_matrix_;
 	XMMATRIX world_matrix_;
 	XMMATRIX ortho_matrix_;
@@ -0,0 +1,167 @@
+#include "font.h"
+
+#include "direct3D.h"
+
+// GGO_GRAY8_BITMAP coverage runs from 0 to this value.
+static const unsigned int GLYPH_COVERAGE_LEVELS = 64;
+
+Font::Font() :
+	direct3D_(0),
+	atlas_(0),
+	device_context_(0),
+	font_(0),
+	previous_font_(0),
+	ascent_(0),
+	line_height_(0)
+{
+	for (int i = 0; i < 128; i++)
+		ascii_cached_[i] = false;
+}
+
+Font::Font(const Font& kOther)
+{
+}
+
+Font::~Font()
+{
+}
+
+bool Font::Initialize(Direct3D* direct3D, TextureAtlas* atlas, const wchar_t* face, int pixel_height)
+{
+	direct3D_ = direct3D;
+	atlas_ = atlas;
+
+	// Create a memory device context to rasterize glyphs with; no window is needed.
+	device_context_ = CreateCompatibleDC(0);
+	if (!device_context_)
+		return false;
+
+	// Create the font. A negative height asks for the character height rather than the cell height.
+	font_ = CreateFontW(-pixel_height, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_TT_PRECIS,
+		CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, face);
+	if (!font_)
+		return false;
+
+	previous_font_ = SelectObject(device_context_, font_);
+
+	// Read the line metrics.
+	TEXTMETRICW metrics;
+	if (!GetTextMetricsW(device_context_, &metrics))
+		return false;
+
+	ascent_ = metrics.tmAscent;
+	line_height_ = metrics.tmHeight + metrics.tmExternalLeading;
+
+	// Cache printable ASCII up front so the first frames of text do not stall on rasterization. An atlas too small to
+	// hold them fails here rather than leaving gaps in every string.
+	for (wchar_t character = 32; character < 127; character++)
+	{
+		if (!GetGlyph(character))
+			return false;
+	}
+
+	return true;
+}
+
+void Font::Shutdown()
+{
+	if (device_context_ && previous_font_)
+		SelectObject(device_context_, previous_font_);
+	previous_font_ = 0;
+
+	if (font_)
+	{
+		DeleteObject(font_);
+		font_ = 0;
+	}
+
+	if (device_context_)
+	{
+		DeleteDC(device_context_);
+		device_context_ = 0;
+	}
+
+	for (int i = 0; i < 128; i++)
+		ascii_cached_[i] = false;
+	glyphs_.clear();
+}
+
+const Glyph* Font::GetGlyph(wchar_t character)
+{
+	// ASCII is looked up directly; everything else goes through the map.
+	if (character < 128)
+	{
+		if (!ascii_cached_[character])
+		{
+			if (!CacheGlyph(character, ascii_glyphs_[character]))
+				return 0;
+			ascii_cached_[character] = true;
+		}
+
+		return &ascii_glyphs_[character];
+	}
+
+	std::unordered_map<wchar_t, Glyph>::iterator found = glyphs_.find(character);
+	if (found != glyphs_.end())
+		return &found->second;
+
+	Glyph glyph;
+	if (!CacheGlyph(character, glyph))
+		return 0;
+
+	return &glyphs_.insert(std::make_pair(character, glyph)).first->second;
+}
+
+int Font::GetLineHeight()
+{
+	return line_height_;
+}
+
+ID3D11ShaderResourceView* Font::GetTexture()
+{
+	return atlas_->GetTexture();
+}
+
+bool Font::CacheGlyph(wchar_t character, Glyph& glyph)
+{
+	// Ask for the size of the glyph's anti-aliased bitmap.
+	GLYPHMETRICS metrics;
+	MAT2 identity = { { 0, 1 }, { 0, 0 }, { 0, 0 }, { 0, 1 } };
+	DWORD size = GetGlyphOutlineW(device_context_, character, GGO_GRAY8_BITMAP, &metrics, 0, 0, &identity);
+	if (size == GDI_ERROR)
+		return false;
+
+	glyph.offset_x = metrics.gmptGlyphOrigin.x;
+	glyph.offset_y = ascent_ - metrics.gmptGlyphOrigin.y;
+	glyph.advance = metrics.gmCellIncX;
+	glyph.region.x = glyph.region.y = glyph.region.width = glyph.region.height = 0;
+	glyph.region.uv = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	// Blank glyphs only move the pen.
+	if (size == 0)
+		return true;
+
+	// Rasterize the coverage. Rows are padded to four bytes.
+	coverage_.resize(size);
+	if (GetGlyphOutlineW(device_context_, character, GGO_GRAY8_BITMAP, &metrics, size, coverage_.data(), &identity) == GDI_ERROR)
+		return false;
+
+	unsigned int width = metrics.gmBlackBoxX;
+	unsigned int height = metrics.gmBlackBoxY;
+	unsigned int pitch = (width + 3) & ~3u;
+
+	// Expand to white with the coverage as alpha, so text tints with the sprite colour like any other sprite.
+	pixels_.resize(width * height * 4);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			unsigned char* pixel = &pixels_[(y * width + x) * 4];
+			pixel[0] = pixel[1] = pixel[2] = 255;
+			pixel[3] = static_cast<unsigned char>((coverage_[y * pitch + x] * 255 + GLYPH_COVERAGE_LEVELS / 2) / GLYPH_COVERAGE_LEVELS);
+		}
+	}
+
+	// A full atlas leaves the glyph uncached, so lookups return 0 and text skips it.
+	return atlas_->Insert(direct3D_, width, height, pixels_.data(), width * 4, glyph.region);
+}
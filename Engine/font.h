@@ -0,0 +1,57 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <Windows.h>
+#include "textureAtlas.h"
+
+class Direct3D;
+
+struct Glyph
+{
+	// Where the glyph's coverage was packed; zero sized for blank glyphs such as space.
+	AtlasRegion region;
+
+	// Offset of the bitmap from the pen position, with y measured down from the top of the line.
+	int offset_x, offset_y;
+
+	// Distance to move the pen after drawing the glyph.
+	int advance;
+};
+
+class Font
+{
+public:
+	Font();
+	Font(const Font&);
+	~Font();
+
+	// Create a GDI font of the given face and pixel height that rasterizes its glyphs into the atlas. Fails if the atlas
+	// cannot hold printable ASCII.
+	bool Initialize(Direct3D*, TextureAtlas*, const wchar_t*, int);
+	void Shutdown();
+
+	// Look a glyph up, rasterizing and caching it on first use. Returns 0 if the font has no such glyph or the
+	// atlas has no room for it.
+	const Glyph* GetGlyph(wchar_t);
+
+	int GetLineHeight();
+	ID3D11ShaderResourceView* GetTexture();
+
+private:
+	bool CacheGlyph(wchar_t, Glyph&);
+
+private:
+	Direct3D* direct3D_;
+	TextureAtlas* atlas_;
+	HDC device_context_;
+	HFONT font_;
+	HGDIOBJ previous_font_;
+	int ascent_;
+	int line_height_;
+	Glyph ascii_glyphs_[128];
+	bool ascii_cached_[128];
+	std::unordered_map<wchar_t, Glyph> glyphs_;
+	std::vector<unsigned char> coverage_;
+	std::vector<unsigned char> pixels_;
+};
@@ -1,8 +1,31 @@
 #include "graphics.h"
 
+#include <cstdio>
+#include <cwchar>
+
+// Report a failure to initialize. Headless sessions have no window and nobody to dismiss a dialog, so they log it.
+static void ReportError(HWND window, const wchar_t* message)
+{
+	if (window)
+	{
+		MessageBox(window, message, L"Error", MB_OK);
+		return;
+	}
+
+	OutputDebugStringW(message);
+	OutputDebugStringW(L"\n");
+	fwprintf(stderr, L"%ls\n", message);
+}
+
 Graphics::Graphics()
 {
 	direct3D_ = 0;
+	animation_ = 0;
+	lod_selector_ = 0;
+	light_clusters_ = 0;
+	overlay_atlas_ = 0;
+	overlay_font_ = 0;
+	sprite_batch_ = 0;
 }
 
 Graphics::Graphics(const Graphics& kOther)
@@ -13,7 +36,7 @@ Graphics::~Graphics()
 {
 }
 
-bool Graphics::Initialize(int screen_width, int screen_height, HWND window)
+bool Graphics::Initialize(int screen_width, int screen_height, HWND window, JobSystem* job_system)
 {
 	// Create the Direct3D object.
 	direct3D_ = new Direct3D();
@@ -24,7 +47,79 @@ bool Graphics::Initialize(int screen_width, int screen_height, HWND window)
 	bool result = direct3D_->Initialize(screen_width, screen_height, VSYNC_ENABLED, window, FULL_SCREEN, SCREEN_DEPTH, SCREEN_NEAR);
 	if (!result)
 	{
-		MessageBox(window, L"Failed the initialize Direct 3D", L"Error", MB_OK);
+		ReportError(window, L"Failed the initialize Direct 3D");
+		return false;
+	}
+
+	// Create the Animation object.
+	animation_ = new Animation();
+	if (!animation_)
+		return false;
+
+	// Initialize the Animation object.
+	if (!animation_->Initialize(direct3D_, job_system))
+	{
+		ReportError(window, L"Failed to initialize the animation system");
+		return false;
+	}
+
+	// Create the LodSelector object.
+	lod_selector_ = new LodSelector();
+	if (!lod_selector_)
+		return false;
+
+	// Initialize the LodSelector object.
+	if (!lod_selector_->Initialize(screen_height, LOD_PIXEL_ERROR))
+	{
+		ReportError(window, L"Failed to initialize the LOD selector");
+		return false;
+	}
+
+	// Create the LightClusters object.
+	light_clusters_ = new LightClusters();
+	if (!light_clusters_)
+		return false;
+
+	// Initialize the LightClusters object over the same depth range as the projection.
+	if (!light_clusters_->Initialize(direct3D_, job_system, screen_width, screen_height, SCREEN_NEAR, SCREEN_DEPTH))
+	{
+		ReportError(window, L"Failed to initialize the light clusters");
+		return false;
+	}
+
+	// Create the TextureAtlas object for the overlay.
+	overlay_atlas_ = new TextureAtlas();
+	if (!overlay_atlas_)
+		return false;
+
+	// Initialize the TextureAtlas object.
+	if (!overlay_atlas_->Initialize(direct3D_, OVERLAY_ATLAS_SIZE, OVERLAY_ATLAS_SIZE))
+	{
+		ReportError(window, L"Failed to initialize the overlay atlas");
+		return false;
+	}
+
+	// Create the Font object.
+	overlay_font_ = new Font();
+	if (!overlay_font_)
+		return false;
+
+	// Initialize the Font object, caching its glyphs in the overlay atlas.
+	if (!overlay_font_->Initialize(direct3D_, overlay_atlas_, L"Consolas", OVERLAY_FONT_HEIGHT))
+	{
+		ReportError(window, L"Failed to initialize the overlay font");
+		return false;
+	}
+
+	// Create the SpriteBatch object.
+	sprite_batch_ = new SpriteBatch();
+	if (!sprite_batch_)
+		return false;
+
+	// Initialize the SpriteBatch object.
+	if (!sprite_batch_->Initialize(direct3D_, screen_width, screen_height))
+	{
+		ReportError(window, L"Failed to initialize the sprite batch");
 		return false;
 	}
 
@@ -33,6 +128,54 @@ bool Graphics::Initialize(int screen_width, int screen_height, HWND window)
 
 void Graphics::Shutdown()
 {
+	// Release the SpriteBatch object.
+	if (sprite_batch_)
+	{
+		sprite_batch_->Shutdown();
+		delete sprite_batch_;
+		sprite_batch_ = 0;
+	}
+
+	// Release the Font object.
+	if (overlay_font_)
+	{
+		overlay_font_->Shutdown();
+		delete overlay_font_;
+		overlay_font_ = 0;
+	}
+
+	// Release the TextureAtlas object.
+	if (overlay_atlas_)
+	{
+		overlay_atlas_->Shutdown();
+		delete overlay_atlas_;
+		overlay_atlas_ = 0;
+	}
+
+	// Release the LightClusters object.
+	if (light_clusters_)
+	{
+		light_clusters_->Shutdown();
+		delete light_clusters_;
+		light_clusters_ = 0;
+	}
+
+	// Release the LodSelector object.
+	if (lod_selector_)
+	{
+		lod_selector_->Shutdown();
+		delete lod_selector_;
+		lod_selector_ = 0;
+	}
+
+	// Release the Animation object.
+	if (animation_)
+	{
+		animation_->Shutdown();
+		delete animation_;
+		animation_ = 0;
+	}
+
 	// Release the Direct3D object.
 	if (direct3D_)
 	{
@@ -42,20 +185,49 @@ void Graphics::Shutdown()
 	}
 }
 
-bool Graphics::Frame()
+bool Graphics::Frame(float frame_time)
 {
+	// Advance the animated characters and build their skinning palettes.
+	animation_->Frame(frame_time);
+
+	// Pick each object's level of detail. There is no camera yet, so the view sits at the origin looking down +z.
+	lod_selector_->Frame(direct3D_, XMMatrixIdentity());
+
+	// Sort this frame's lights into clusters from the same view.
+	light_clusters_->Frame(XMMatrixIdentity());
+
 	// Render the graphics scene.
-	if (!Render())
+	if (!Render(frame_time))
 		return false;
 
 	return true;
 }
 
-bool Graphics::Render()
+bool Graphics::Render(float frame_time)
 {
 	// Clear the buffers in order to begin the scene.
 	direct3D_->BeginScene(0.5f, 0.5f, 0.5f, 1.0f);
 
+	// Give the pixel shaders the clustered lights.
+	if (!light_clusters_->SetShaderResources(direct3D_))
+		return false;
+
+	// Upload and bind each animated character's skinning palette ahead of its draw.
+	for (unsigned int character = 0; character < animation_->GetCharacterCount(); character++)
+	{
+		if (!animation_->SetPalette(direct3D_, character))
+			return false;
+	}
+
+	// Draw the overlay over the scene.
+	wchar_t overlay_text[64];
+	swprintf_s(overlay_text, 64, L"Frame: %.2f ms", frame_time * 1000.0f);
+
+	sprite_batch_->Begin();
+	sprite_batch_->DrawString(overlay_font_, overlay_text, 8.0f, 8.0f, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), 0);
+	if (!sprite_batch_->End(direct3D_))
+		return false;
+
 	// Present the rendered scene to the screen.
 	direct3D_->EndScene();
 	return true;
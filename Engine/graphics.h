@@ -1,12 +1,22 @@
 #pragma once
 #include <Windows.h>
 #include "direct3D.h"
+#include "animation.h"
+#include "font.h"
+#include "jobSystem.h"
+#include "lightClusters.h"
+#include "meshLod.h"
+#include "spriteBatch.h"
+#include "textureAtlas.h"
 
 // Global variables.
 const bool FULL_SCREEN = false;
 const bool VSYNC_ENABLED = true;
 const float SCREEN_DEPTH = 1000.0f;
 const float SCREEN_NEAR = 0.1f;
+const float LOD_PIXEL_ERROR = 1.0f;
+const unsigned int OVERLAY_ATLAS_SIZE = 512;
+const int OVERLAY_FONT_HEIGHT = 16;
 
 class Graphics
 {
@@ -15,14 +25,20 @@ public:
 	Graphics(const Graphics&);
 	~Graphics();
 
-	bool Initialize(int, int, HWND);
+	bool Initialize(int, int, HWND, JobSystem*);
 	void Shutdown();
-	bool Frame();
+	bool Frame(float);
 
 private:
-	bool Render();
+	bool Render(float);
 
 private:
 	Direct3D* direct3D_;
+	Animation* animation_;
+	LodSelector* lod_selector_;
+	LightClusters* light_clusters_;
+	TextureAtlas* overlay_atlas_;
+	Font* overlay_font_;
+	SpriteBatch* sprite_batch_;
 };
 
@@ -0,0 +1,138 @@
+#include "jobSystem.h"
+
+#include <atomic>
+#include <memory>
+
+JobSystem::JobSystem() :
+	running_(false)
+{
+}
+
+JobSystem::JobSystem(const JobSystem& kOther)
+{
+}
+
+JobSystem::~JobSystem()
+{
+}
+
+bool JobSystem::Initialize(unsigned int worker_count)
+{
+	// Leave one hardware thread for the main thread when no explicit count was requested.
+	if (worker_count == 0)
+	{
+		unsigned int hardware_threads = std::thread::hardware_concurrency();
+		worker_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+	}
+
+	// Start the worker threads.
+	running_ = true;
+	for (unsigned int i = 0; i < worker_count; i++)
+		workers_.emplace_back(&JobSystem::WorkerLoop, this);
+
+	return true;
+}
+
+void JobSystem::Shutdown()
+{
+	// Signal the workers to exit once the queue has drained.
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_ = false;
+	}
+	wake_condition_.notify_all();
+
+	// Wait for every worker to finish.
+	for (std::thread& worker : workers_)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+	workers_.clear();
+}
+
+void JobSystem::Execute(const std::function<void()>& job)
+{
+	// Push the job onto the queue and wake a single worker to pick it up.
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(job);
+	}
+	wake_condition_.notify_one();
+}
+
+void JobSystem::Dispatch(unsigned int count, unsigned int group_size, const std::function<void(unsigned int, unsigned int)>& job)
+{
+	if (count == 0)
+		return;
+
+	if (group_size == 0)
+		group_size = 1;
+
+	// The shared state is reference counted as helper jobs may still be queued after the final group has been claimed.
+	struct DispatchState
+	{
+		std::atomic<unsigned int> next_group;
+		std::atomic<unsigned int> completed_groups;
+	};
+	std::shared_ptr<DispatchState> state = std::make_shared<DispatchState>();
+	state->next_group = 0;
+	state->completed_groups = 0;
+
+	const unsigned int group_count = (count + group_size - 1) / group_size;
+
+	// Claim and run groups until none are left.
+	// The job function is only referenced while a group is running, which is always before Dispatch returns.
+	const std::function<void(unsigned int, unsigned int)>* job_function = &job;
+	auto run_groups = [state, job_function, count, group_size, group_count]()
+	{
+		for (unsigned int group = state->next_group++; group < group_count; group = state->next_group++)
+		{
+			unsigned int begin = group * group_size;
+			unsigned int end = begin + group_size < count ? begin + group_size : count;
+			(*job_function)(begin, end);
+			state->completed_groups++;
+		}
+	};
+
+	// Wake enough workers to help with the remaining groups. The calling thread takes part as well.
+	unsigned int helper_count = group_count - 1;
+	if (helper_count > static_cast<unsigned int>(workers_.size()))
+		helper_count = static_cast<unsigned int>(workers_.size());
+
+	for (unsigned int i = 0; i < helper_count; i++)
+		Execute(run_groups);
+
+	run_groups();
+
+	// Wait for groups still running on the workers.
+	while (state->completed_groups.load() < group_count)
+		std::this_thread::yield();
+}
+
+unsigned int JobSystem::GetWorkerCount()
+{
+	return static_cast<unsigned int>(workers_.size());
+}
+
+void JobSystem::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+
+		// Sleep until there is a job to run or the system is shutting down.
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_condition_.wait(lock, [this]() { return !jobs_.empty() || !running_; });
+
+			if (jobs_.empty())
+				return;
+
+			job = std::move(jobs_.front());
+			jobs_.pop_front();
+		}
+
+		job();
+	}
+}
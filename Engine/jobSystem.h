@@ -0,0 +1,39 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem
+{
+public:
+	JobSystem();
+	JobSystem(const JobSystem&);
+	~JobSystem();
+
+	// Start the worker threads (0 uses one worker per spare hardware thread).
+	bool Initialize(unsigned int);
+	void Shutdown();
+
+	// Queue a single job to be run by the next free worker thread.
+	void Execute(const std::function<void()>&);
+
+	// Split the range [0, count) into groups of the given size and run them across the workers and the calling thread.
+	// Returns once every group has completed.
+	void Dispatch(unsigned int, unsigned int, const std::function<void(unsigned int, unsigned int)>&);
+
+	unsigned int GetWorkerCount();
+
+private:
+	void WorkerLoop();
+
+private:
+	std::vector<std::thread> workers_;
+	std::deque<std::function<void()>> jobs_;
+	std::mutex mutex_;
+	std::condition_variable wake_condition_;
+	bool running_;
+};
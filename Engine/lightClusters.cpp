@@ -0,0 +1,445 @@
+#include "lightClusters.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <emmintrin.h>
+#include "batchMath.h"
+#include "direct3D.h"
+#include "jobSystem.h"
+
+// Spot cones wider than this half angle are bounded by the sphere through their cap instead of their apex.
+static const float WIDE_SPOT_ANGLE = XM_PI / 4.0f;
+
+LightClusters::LightClusters()
+{
+	job_system_ = 0;
+	tiles_x_ = 0;
+	tiles_y_ = 0;
+	slice_scale_ = 0.0f;
+	slice_bias_ = 0.0f;
+	constant_buffer_ = 0;
+	light_buffer_ = 0;
+	grid_buffer_ = 0;
+	index_buffer_ = 0;
+	light_view_ = 0;
+	grid_view_ = 0;
+	index_view_ = 0;
+}
+
+LightClusters::LightClusters(const LightClusters& kOther)
+{
+}
+
+LightClusters::~LightClusters()
+{
+}
+
+bool LightClusters::Initialize(Direct3D* direct3D, JobSystem* job_system, int screen_width, int screen_height, float screen_near, float screen_depth)
+{
+	if (!direct3D || screen_width <= 0 || screen_height <= 0 || screen_near <= 0.0f || screen_depth <= screen_near)
+		return false;
+
+	job_system_ = job_system;
+	tiles_x_ = (screen_width + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE;
+	tiles_y_ = (screen_height + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE;
+
+	// Slice k starts at near * (far / near)^(k / slices), so a view depth maps back to its slice with one log.
+	float depth_ratio_log = logf(screen_depth / screen_near);
+	slice_scale_ = CLUSTER_SLICES / depth_ratio_log;
+	slice_bias_ = -CLUSTER_SLICES * logf(screen_near) / depth_ratio_log;
+
+	slice_depths_.resize(CLUSTER_SLICES + 1);
+	for (unsigned int slice = 0; slice <= CLUSTER_SLICES; slice++)
+		slice_depths_[slice] = screen_near * powf(screen_depth / screen_near, static_cast<float>(slice) / CLUSTER_SLICES);
+
+	// A pixel at normalized device x sees view space x = ndc_x * z / projection._11, and likewise for y with _22.
+	XMMATRIX projection;
+	direct3D->GetProjectionMatrix(projection);
+	XMFLOAT4X4 projection_elements;
+	XMStoreFloat4x4(&projection_elements, projection);
+
+	unsigned int cluster_count = GetClusterCount();
+	cluster_minimums_.resize(cluster_count);
+	cluster_maximums_.resize(cluster_count);
+
+	unsigned int cluster = 0;
+	for (unsigned int slice = 0; slice < CLUSTER_SLICES; slice++)
+	{
+		float depths[2] = { slice_depths_[slice], slice_depths_[slice + 1] };
+		for (unsigned int tile_y = 0; tile_y < tiles_y_; tile_y++)
+		{
+			// Pixel rows run down the screen while normalized device y runs up.
+			float top = 1.0f - 2.0f * (tile_y * CLUSTER_TILE_SIZE) / screen_height;
+			float bottom = 1.0f - 2.0f * (std::min)((tile_y + 1) * CLUSTER_TILE_SIZE, static_cast<unsigned int>(screen_height)) / screen_height;
+			for (unsigned int tile_x = 0; tile_x < tiles_x_; tile_x++, cluster++)
+			{
+				float left = 2.0f * (tile_x * CLUSTER_TILE_SIZE) / screen_width - 1.0f;
+				float right = 2.0f * (std::min)((tile_x + 1) * CLUSTER_TILE_SIZE, static_cast<unsigned int>(screen_width)) / screen_width - 1.0f;
+
+				// The tile's sides spread out with depth, so the box has to cover its corners at both slice depths.
+				XMFLOAT3 minimum(FLT_MAX, FLT_MAX, depths[0]);
+				XMFLOAT3 maximum(-FLT_MAX, -FLT_MAX, depths[1]);
+				for (unsigned int i = 0; i < 2; i++)
+				{
+					float x[2] = { left * depths[i] / projection_elements._11, right * depths[i] / projection_elements._11 };
+					float y[2] = { bottom * depths[i] / projection_elements._22, top * depths[i] / projection_elements._22 };
+					minimum.x = (std::min)(minimum.x, x[0]);
+					maximum.x = (std::max)(maximum.x, x[1]);
+					minimum.y = (std::min)(minimum.y, y[0]);
+					maximum.y = (std::max)(maximum.y, y[1]);
+				}
+
+				cluster_minimums_[cluster] = minimum;
+				cluster_maximums_[cluster] = maximum;
+			}
+		}
+	}
+
+	slices_.resize(CLUSTER_SLICES);
+	grid_.resize(cluster_count);
+	for (unsigned int i = 0; i < cluster_count; i++)
+	{
+		grid_[i].offset = 0;
+		grid_[i].count = 0;
+	}
+
+	// Create the buffers the pixel shader reads the clusters from.
+	if (!direct3D->CreateConstantBuffer(sizeof(ClusterConstants), &constant_buffer_))
+		return false;
+
+	if (!direct3D->CreateStructuredBuffer(sizeof(ClusterLight), MAX_CLUSTER_LIGHTS, &light_buffer_, &light_view_))
+		return false;
+
+	if (!direct3D->CreateStructuredBuffer(sizeof(ClusterRange), cluster_count, &grid_buffer_, &grid_view_))
+		return false;
+
+	if (!direct3D->CreateStructuredBuffer(sizeof(unsigned int), MAX_CLUSTER_LIGHT_INDICES, &index_buffer_, &index_view_))
+		return false;
+
+	return true;
+}
+
+void LightClusters::Shutdown()
+{
+	// Release the shader resource views.
+	if (index_view_)
+	{
+		index_view_->Release();
+		index_view_ = 0;
+	}
+
+	if (grid_view_)
+	{
+		grid_view_->Release();
+		grid_view_ = 0;
+	}
+
+	if (light_view_)
+	{
+		light_view_->Release();
+		light_view_ = 0;
+	}
+
+	// Release the buffers.
+	if (index_buffer_)
+	{
+		index_buffer_->Release();
+		index_buffer_ = 0;
+	}
+
+	if (grid_buffer_)
+	{
+		grid_buffer_->Release();
+		grid_buffer_ = 0;
+	}
+
+	if (light_buffer_)
+	{
+		light_buffer_->Release();
+		light_buffer_ = 0;
+	}
+
+	if (constant_buffer_)
+	{
+		constant_buffer_->Release();
+		constant_buffer_ = 0;
+	}
+
+	ClearLights();
+	slice_depths_.clear();
+	cluster_minimums_.clear();
+	cluster_maximums_.clear();
+	slices_.clear();
+	grid_.clear();
+	indices_.clear();
+	job_system_ = 0;
+}
+
+void LightClusters::ClearLights()
+{
+	lights_.clear();
+	position_x_.clear();
+	position_y_.clear();
+	position_z_.clear();
+	direction_x_.clear();
+	direction_y_.clear();
+	direction_z_.clear();
+	sphere_offsets_.clear();
+	sphere_radii_.clear();
+}
+
+bool LightClusters::AddPointLight(const XMFLOAT3& position, float range, const XMFLOAT3& colour)
+{
+	return AddLight(position, XMFLOAT3(0.0f, 0.0f, 1.0f), range, -1.0f, colour, 0.0f, range);
+}
+
+bool LightClusters::AddSpotLight(const XMFLOAT3& position, const XMFLOAT3& direction, float range, float half_angle, const XMFLOAT3& colour)
+{
+	XMFLOAT3 unit_direction;
+	XMStoreFloat3(&unit_direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+
+	// Bound the cone with the smallest sphere that holds its apex and cap. Narrow cones fit the sphere through the apex
+	// and the cap rim; wide ones fit the sphere around the cap rim alone.
+	float cosine = cosf(half_angle);
+	float offset, radius;
+	if (half_angle <= WIDE_SPOT_ANGLE)
+	{
+		radius = range / (2.0f * cosine);
+		offset = radius;
+	}
+	else
+	{
+		radius = range * sinf(half_angle);
+		offset = range * cosine;
+	}
+
+	return AddLight(position, unit_direction, range, cosine, colour, offset, radius);
+}
+
+void LightClusters::Frame(const XMMATRIX& view)
+{
+	unsigned int light_count = GetLightCount();
+	unsigned int cluster_count = GetClusterCount();
+	if (cluster_count == 0)
+		return;
+
+	// Move the lights into view space in two batches.
+	view_position_x_.resize(light_count);
+	view_position_y_.resize(light_count);
+	view_position_z_.resize(light_count);
+	view_direction_x_.resize(light_count);
+	view_direction_y_.resize(light_count);
+	view_direction_z_.resize(light_count);
+
+	XMFLOAT4X4 view_matrix;
+	XMStoreFloat4x4(&view_matrix, view);
+	Float3SoA positions = { position_x_.data(), position_y_.data(), position_z_.data() };
+	Float3SoA view_positions = { view_position_x_.data(), view_position_y_.data(), view_position_z_.data() };
+	BatchTransformPoints(view_matrix, positions, view_positions, light_count);
+
+	Float3SoA directions = { direction_x_.data(), direction_y_.data(), direction_z_.data() };
+	Float3SoA view_directions = { view_direction_x_.data(), view_direction_y_.data(), view_direction_z_.data() };
+	BatchTransformVectors(view_matrix, directions, view_directions, light_count);
+
+	for (unsigned int light = 0; light < light_count; light++)
+	{
+		lights_[light].position = XMFLOAT3(view_position_x_[light], view_position_y_[light], view_position_z_[light]);
+		lights_[light].direction = XMFLOAT3(view_direction_x_[light], view_direction_y_[light], view_direction_z_[light]);
+	}
+
+	// Each slice only reads the lights and writes its own lists, so the slices run in parallel.
+	std::function<void(unsigned int, unsigned int)> assign = [this](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int slice = begin; slice < end; slice++)
+			AssignSlice(slice);
+	};
+
+	if (job_system_)
+		job_system_->Dispatch(CLUSTER_SLICES, 1, assign);
+	else
+		assign(0, CLUSTER_SLICES);
+
+	// Join the slice lists into one index list. Clusters that no longer fit keep what did.
+	indices_.clear();
+	unsigned int cluster = 0;
+	for (unsigned int slice = 0; slice < CLUSTER_SLICES; slice++)
+	{
+		const SliceLights& slice_lights = slices_[slice];
+		const unsigned int* source = slice_lights.indices.data();
+		for (unsigned int tile = 0; tile < slice_lights.counts.size(); tile++, cluster++)
+		{
+			unsigned int count = slice_lights.counts[tile];
+			unsigned int offset = static_cast<unsigned int>(indices_.size());
+			unsigned int kept = (std::min)(count, MAX_CLUSTER_LIGHT_INDICES - offset);
+
+			indices_.insert(indices_.end(), source, source + kept);
+			grid_[cluster].offset = offset;
+			grid_[cluster].count = kept;
+			source += count;
+		}
+	}
+}
+
+bool LightClusters::SetShaderResources(Direct3D* direct3D)
+{
+	ClusterConstants constants;
+	constants.slice_scale = slice_scale_;
+	constants.slice_bias = slice_bias_;
+	constants.tile_size = CLUSTER_TILE_SIZE;
+	constants.light_count = GetLightCount();
+	constants.tiles_x = tiles_x_;
+	constants.tiles_y = tiles_y_;
+	constants.slices = CLUSTER_SLICES;
+	constants.padding = 0;
+
+	if (!direct3D->UpdateConstantBuffer(constant_buffer_, &constants, sizeof(constants)))
+		return false;
+
+	// Upload only the part of each buffer in use this frame.
+	if (!lights_.empty() && !direct3D->UpdateDynamicBuffer(light_buffer_, lights_.data(), static_cast<unsigned int>(lights_.size() * sizeof(ClusterLight))))
+		return false;
+
+	if (!direct3D->UpdateDynamicBuffer(grid_buffer_, grid_.data(), static_cast<unsigned int>(grid_.size() * sizeof(ClusterRange))))
+		return false;
+
+	if (!indices_.empty() && !direct3D->UpdateDynamicBuffer(index_buffer_, indices_.data(), static_cast<unsigned int>(indices_.size() * sizeof(unsigned int))))
+		return false;
+
+	// Bind the constants and the three buffers, which sit in consecutive slots.
+	ID3D11ShaderResourceView* views[3] = { light_view_, grid_view_, index_view_ };
+	ID3D11DeviceContext* device_context = direct3D->GetDeviceContext();
+	device_context->PSSetConstantBuffers(CLUSTER_CONSTANTS_SLOT, 1, &constant_buffer_);
+	device_context->PSSetShaderResources(CLUSTER_LIGHT_SLOT, 3, views);
+	return true;
+}
+
+unsigned int LightClusters::GetLightCount()
+{
+	return static_cast<unsigned int>(lights_.size());
+}
+
+unsigned int LightClusters::GetClusterCount()
+{
+	return tiles_x_ * tiles_y_ * CLUSTER_SLICES;
+}
+
+const ClusterRange& LightClusters::GetClusterRange(unsigned int cluster)
+{
+	return grid_[cluster];
+}
+
+const std::vector<unsigned int>& LightClusters::GetLightIndices()
+{
+	return indices_;
+}
+
+bool LightClusters::AddLight(const XMFLOAT3& position, const XMFLOAT3& direction, float range, float spot_cos_angle, const XMFLOAT3& colour, float sphere_offset, float sphere_radius)
+{
+	if (lights_.size() >= MAX_CLUSTER_LIGHTS || range <= 0.0f)
+		return false;
+
+	ClusterLight light;
+	light.position = position;
+	light.range = range;
+	light.direction = direction;
+	light.spot_cos_angle = spot_cos_angle;
+	light.colour = colour;
+	light.padding = 0.0f;
+	lights_.push_back(light);
+
+	position_x_.push_back(position.x);
+	position_y_.push_back(position.y);
+	position_z_.push_back(position.z);
+	direction_x_.push_back(direction.x);
+	direction_y_.push_back(direction.y);
+	direction_z_.push_back(direction.z);
+	sphere_offsets_.push_back(sphere_offset);
+	sphere_radii_.push_back(sphere_radius);
+	return true;
+}
+
+void LightClusters::AssignSlice(unsigned int slice)
+{
+	SliceLights& slice_lights = slices_[slice];
+	slice_lights.centre_x.clear();
+	slice_lights.centre_y.clear();
+	slice_lights.centre_z.clear();
+	slice_lights.radius_squared.clear();
+	slice_lights.lights.clear();
+	slice_lights.indices.clear();
+	slice_lights.counts.assign(tiles_x_ * tiles_y_, 0);
+
+	// Gather the bounding spheres that reach this slice's depth range.
+	float near_depth = slice_depths_[slice];
+	float far_depth = slice_depths_[slice + 1];
+	unsigned int light_count = GetLightCount();
+	for (unsigned int light = 0; light < light_count; light++)
+	{
+		float offset = sphere_offsets_[light];
+		float radius = sphere_radii_[light];
+		float z = view_position_z_[light] + view_direction_z_[light] * offset;
+		if (z + radius < near_depth || z - radius > far_depth)
+			continue;
+
+		slice_lights.centre_x.push_back(view_position_x_[light] + view_direction_x_[light] * offset);
+		slice_lights.centre_y.push_back(view_position_y_[light] + view_direction_y_[light] * offset);
+		slice_lights.centre_z.push_back(z);
+		slice_lights.radius_squared.push_back(radius * radius);
+		slice_lights.lights.push_back(light);
+	}
+
+	unsigned int candidate_count = static_cast<unsigned int>(slice_lights.lights.size());
+	if (candidate_count == 0)
+		return;
+
+	// Pad to whole vectors with spheres of negative squared radius, which no box can reach.
+	while (slice_lights.lights.size() % 4 != 0)
+	{
+		slice_lights.centre_x.push_back(0.0f);
+		slice_lights.centre_y.push_back(0.0f);
+		slice_lights.centre_z.push_back(0.0f);
+		slice_lights.radius_squared.push_back(-1.0f);
+		slice_lights.lights.push_back(0);
+	}
+
+	// Test four spheres against each cluster box at a time. A sphere touches the box when the squared distance from its
+	// centre to the nearest point of the box is within its squared radius.
+	unsigned int padded_count = static_cast<unsigned int>(slice_lights.lights.size());
+	unsigned int tile_count = tiles_x_ * tiles_y_;
+	unsigned int first_cluster = slice * tile_count;
+	__m128 zero = _mm_setzero_ps();
+	for (unsigned int tile = 0; tile < tile_count; tile++)
+	{
+		const XMFLOAT3& minimum = cluster_minimums_[first_cluster + tile];
+		const XMFLOAT3& maximum = cluster_maximums_[first_cluster + tile];
+		__m128 minimum_x = _mm_set1_ps(minimum.x), maximum_x = _mm_set1_ps(maximum.x);
+		__m128 minimum_y = _mm_set1_ps(minimum.y), maximum_y = _mm_set1_ps(maximum.y);
+		__m128 minimum_z = _mm_set1_ps(minimum.z), maximum_z = _mm_set1_ps(maximum.z);
+
+		unsigned int count = 0;
+		for (unsigned int i = 0; i < padded_count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(&slice_lights.centre_x[i]);
+			__m128 y = _mm_loadu_ps(&slice_lights.centre_y[i]);
+			__m128 z = _mm_loadu_ps(&slice_lights.centre_z[i]);
+
+			__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minimum_x, x), _mm_sub_ps(x, maximum_x)), zero);
+			__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minimum_y, y), _mm_sub_ps(y, maximum_y)), zero);
+			__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minimum_z, z), _mm_sub_ps(z, maximum_z)), zero);
+			__m128 distance_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+			int mask = _mm_movemask_ps(_mm_cmple_ps(distance_squared, _mm_loadu_ps(&slice_lights.radius_squared[i])));
+			for (unsigned int lane = 0; mask != 0; lane++, mask >>= 1)
+			{
+				if (mask & 1)
+				{
+					slice_lights.indices.push_back(slice_lights.lights[i + lane]);
+					count++;
+				}
+			}
+		}
+
+		slice_lights.counts[tile] = count;
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <d3d11.h>
+#include <DirectXMath.h>
+using namespace DirectX;
+
+class Direct3D;
+class JobSystem;
+
+// Screen tiles are this many pixels square.
+const unsigned int CLUSTER_TILE_SIZE = 64;
+
+// Depth slices between the near and far planes, spaced exponentially so clusters stay roughly cube shaped.
+const unsigned int CLUSTER_SLICES = 24;
+
+// Capacity of the uploaded light and light index buffers. Lights past the first limit are dropped, and clusters past
+// the second are left with shortened lists.
+const unsigned int MAX_CLUSTER_LIGHTS = 1024;
+const unsigned int MAX_CLUSTER_LIGHT_INDICES = 131072;
+
+// Pixel shader slots the cluster data is bound to: the constants, then the light, grid and index buffers.
+const unsigned int CLUSTER_CONSTANTS_SLOT = 2;
+const unsigned int CLUSTER_LIGHT_SLOT = 4;
+const unsigned int CLUSTER_GRID_SLOT = 5;
+const unsigned int CLUSTER_INDEX_SLOT = 6;
+
+// A light as the shaders see it, in view space. Point lights have a spot_cos_angle of -1 so every direction passes.
+struct ClusterLight
+{
+	XMFLOAT3 position;
+	float range;
+	XMFLOAT3 direction;
+	float spot_cos_angle;
+	XMFLOAT3 colour;
+	float padding;
+};
+
+// Where a cluster's lights are in the index buffer.
+struct ClusterRange
+{
+	unsigned int offset;
+	unsigned int count;
+};
+
+// Everything a shader needs to find its cluster:
+//   tile = uint2(pixel.xy / tile_size)
+//   slice = uint(max(log(view_z) * slice_scale + slice_bias, 0))
+//   cluster = (slice * tiles_y + tile.y) * tiles_x + tile.x
+struct ClusterConstants
+{
+	float slice_scale;
+	float slice_bias;
+	unsigned int tile_size;
+	unsigned int light_count;
+	unsigned int tiles_x;
+	unsigned int tiles_y;
+	unsigned int slices;
+	unsigned int padding;
+};
+
+class LightClusters
+{
+public:
+	LightClusters();
+	LightClusters(const LightClusters&);
+	~LightClusters();
+
+	// Build the cluster bounds for a screen size and the Direct3D projection between its near and far planes. Without a
+	// job system the slices are assigned on the calling thread.
+	bool Initialize(Direct3D*, JobSystem*, int, int, float, float);
+	void Shutdown();
+
+	// Lights are given in world space and rebuilt every frame: clear them, add this frame's lights, then call Frame.
+	// Adding fails once MAX_CLUSTER_LIGHTS are queued.
+	void ClearLights();
+	bool AddPointLight(const XMFLOAT3&, float, const XMFLOAT3&);
+	bool AddSpotLight(const XMFLOAT3&, const XMFLOAT3&, float, float, const XMFLOAT3&);
+
+	// Move the lights into view space and assign them to clusters, one depth slice per job.
+	void Frame(const XMMATRIX&);
+
+	// Upload the lights and cluster lists and bind them to the pixel shader.
+	bool SetShaderResources(Direct3D*);
+
+	unsigned int GetLightCount();
+	unsigned int GetClusterCount();
+	const ClusterRange& GetClusterRange(unsigned int);
+	const std::vector<unsigned int>& GetLightIndices();
+
+private:
+	// Lights overlapping one depth slice, padded to a multiple of four, and the per tile lists found for them.
+	struct SliceLights
+	{
+		std::vector<float> centre_x, centre_y, centre_z, radius_squared;
+		std::vector<unsigned int> lights;
+		std::vector<unsigned int> counts;
+		std::vector<unsigned int> indices;
+	};
+
+	bool AddLight(const XMFLOAT3&, const XMFLOAT3&, float, float, const XMFLOAT3&, float, float);
+	void AssignSlice(unsigned int);
+
+private:
+	JobSystem* job_system_;
+	unsigned int tiles_x_;
+	unsigned int tiles_y_;
+	float slice_scale_;
+	float slice_bias_;
+
+	// View space depth of each slice boundary, and the bounds of every cluster ordered by slice, row then column.
+	std::vector<float> slice_depths_;
+	std::vector<XMFLOAT3> cluster_minimums_;
+	std::vector<XMFLOAT3> cluster_maximums_;
+
+	// This frame's lights. Positions and directions are kept in world space as streams for the batch transforms; the
+	// bounding sphere sits sphere_offsets_ along the direction from the position.
+	std::vector<ClusterLight> lights_;
+	std::vector<float> position_x_, position_y_, position_z_;
+	std::vector<float> direction_x_, direction_y_, direction_z_;
+	std::vector<float> view_position_x_, view_position_y_, view_position_z_;
+	std::vector<float> view_direction_x_, view_direction_y_, view_direction_z_;
+	std::vector<float> sphere_offsets_, sphere_radii_;
+
+	std::vector<SliceLights> slices_;
+	std::vector<ClusterRange> grid_;
+	std::vector<unsigned int> indices_;
+
+	ID3D11Buffer* constant_buffer_;
+	ID3D11Buffer* light_buffer_;
+	ID3D11Buffer* grid_buffer_;
+	ID3D11Buffer* index_buffer_;
+	ID3D11ShaderResourceView* light_view_;
+	ID3D11ShaderResourceView* grid_view_;
+	ID3D11ShaderResourceView* index_view_;
+};
@@ -8,7 +8,7 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prev_instance, PSTR cmd_line, i
 		return 0;
 
 	// Initialize and run the system object if it is valid.
-	bool result = system->Initialize();
+	bool result = system->Initialize(cmd_line, 0);
 	if (result)
 		system->Run();
 
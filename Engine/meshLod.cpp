@@ -0,0 +1,677 @@
+#include "meshLod.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include "batchMath.h"
+#include "direct3D.h"
+
+// Vertex flags used while simplifying.
+static const unsigned char VERTEX_LOCKED = 1;
+static const unsigned char VERTEX_BORDER = 2;
+
+// Planes added along open edges count this much more than surface planes so outlines hold their shape.
+static const double BORDER_WEIGHT = 10.0;
+
+// A collapse is rejected when it turns a neighbouring triangle further than this from its facing (cosine of the angle).
+static const float MINIMUM_NORMAL_DOT = 0.25f;
+
+// Sum of squared distances to a set of planes, weighted by triangle area, as a symmetric 4x4 matrix.
+struct Quadric
+{
+	double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+	double weight;
+};
+
+// A candidate collapse of one vertex into a neighbour, queued by cost. The versions detect candidates made stale by
+// later collapses.
+struct Collapse
+{
+	float cost;
+	unsigned int from, to;
+	unsigned int from_version, to_version;
+
+	bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+// Working state shared by the simplification passes of a mesh.
+struct Simplifier
+{
+	const XMFLOAT3* positions;
+	std::vector<Quadric> quadrics;
+	std::vector<unsigned char> flags;
+
+	// Unit planes (normal, distance) of the source triangles and open edges, and the planes each vertex stands in for:
+	// its own to begin with, plus those of every vertex collapsed into it.
+	std::vector<XMFLOAT4> planes;
+	std::vector<std::vector<unsigned int>> vertex_planes;
+};
+
+static void AddPlane(Quadric& quadric, double a, double b, double c, double d, double weight)
+{
+	quadric.a00 += weight * a * a;
+	quadric.a01 += weight * a * b;
+	quadric.a02 += weight * a * c;
+	quadric.a03 += weight * a * d;
+	quadric.a11 += weight * b * b;
+	quadric.a12 += weight * b * c;
+	quadric.a13 += weight * b * d;
+	quadric.a22 += weight * c * c;
+	quadric.a23 += weight * c * d;
+	quadric.a33 += weight * d * d;
+	quadric.weight += weight;
+}
+
+static void AddQuadric(Quadric& quadric, const Quadric& other)
+{
+	quadric.a00 += other.a00;
+	quadric.a01 += other.a01;
+	quadric.a02 += other.a02;
+	quadric.a03 += other.a03;
+	quadric.a11 += other.a11;
+	quadric.a12 += other.a12;
+	quadric.a13 += other.a13;
+	quadric.a22 += other.a22;
+	quadric.a23 += other.a23;
+	quadric.a33 += other.a33;
+	quadric.weight += other.weight;
+}
+
+// Record an unweighted source plane against a vertex, for measuring the error of the levels.
+static void AddSourcePlane(Simplifier& simplifier, unsigned int vertex, unsigned int plane)
+{
+	simplifier.vertex_planes[vertex].push_back(plane);
+}
+
+static double Evaluate(const Quadric& quadric, const XMFLOAT3& position)
+{
+	double x = position.x, y = position.y, z = position.z;
+	return quadric.a00 * x * x + 2.0 * quadric.a01 * x * y + 2.0 * quadric.a02 * x * z + 2.0 * quadric.a03 * x +
+		quadric.a11 * y * y + 2.0 * quadric.a12 * y * z + 2.0 * quadric.a13 * y +
+		quadric.a22 * z * z + 2.0 * quadric.a23 * z + quadric.a33;
+}
+
+static XMVECTOR TriangleNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+{
+	XMVECTOR origin = XMLoadFloat3(&a);
+	return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&b), origin), XMVectorSubtract(XMLoadFloat3(&c), origin));
+}
+
+static void BuildQuadrics(Simplifier& simplifier, unsigned int vertex_count, const std::vector<unsigned int>& indices)
+{
+	const XMFLOAT3* positions = simplifier.positions;
+	Quadric empty = {};
+	simplifier.quadrics.assign(vertex_count, empty);
+	simplifier.flags.assign(vertex_count, 0);
+	simplifier.planes.clear();
+	simplifier.vertex_planes.assign(vertex_count, std::vector<unsigned int>());
+
+	// Every vertex starts with the planes of the triangles around it.
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		XMVECTOR normal = TriangleNormal(positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]);
+		float length = XMVectorGetX(XMVector3Length(normal));
+		if (length <= 0.0f)
+			continue;
+
+		XMFLOAT3 unit;
+		XMStoreFloat3(&unit, XMVectorScale(normal, 1.0f / length));
+		const XMFLOAT3& point = positions[indices[i]];
+		double distance = -(unit.x * point.x + unit.y * point.y + unit.z * point.z);
+
+		unsigned int plane = static_cast<unsigned int>(simplifier.planes.size());
+		simplifier.planes.push_back(XMFLOAT4(unit.x, unit.y, unit.z, static_cast<float>(distance)));
+		for (int k = 0; k < 3; k++)
+		{
+			AddPlane(simplifier.quadrics[indices[i + k]], unit.x, unit.y, unit.z, distance, length * 0.5);
+			AddSourcePlane(simplifier, indices[i + k], plane);
+		}
+	}
+
+	// Edges used by a single triangle are open. Their vertices get a plane through the edge at right angles to the
+	// triangle, which keeps them from sliding inwards.
+	std::vector<std::pair<unsigned int, unsigned int>> edges;
+	edges.reserve(indices.size());
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+			edges.push_back(std::make_pair((std::min)(a, b), (std::max)(a, b)));
+		}
+	}
+	std::vector<std::pair<unsigned int, unsigned int>> sorted_edges = edges;
+	std::sort(sorted_edges.begin(), sorted_edges.end());
+
+	for (size_t i = 0; i < edges.size(); i++)
+	{
+		auto range = std::equal_range(sorted_edges.begin(), sorted_edges.end(), edges[i]);
+		if (range.second - range.first != 1)
+			continue;
+
+		size_t triangle = i / 3 * 3;
+		unsigned int a = indices[i], b = indices[triangle + (i - triangle + 1) % 3];
+		XMVECTOR normal = TriangleNormal(positions[indices[triangle]], positions[indices[triangle + 1]], positions[indices[triangle + 2]]);
+		XMVECTOR edge = XMVectorSubtract(XMLoadFloat3(&positions[b]), XMLoadFloat3(&positions[a]));
+		XMVECTOR side = XMVector3Cross(edge, normal);
+		float length = XMVectorGetX(XMVector3Length(side));
+		if (length <= 0.0f)
+			continue;
+
+		XMFLOAT3 unit;
+		XMStoreFloat3(&unit, XMVectorScale(side, 1.0f / length));
+		double distance = -(unit.x * positions[a].x + unit.y * positions[a].y + unit.z * positions[a].z);
+		double weight = BORDER_WEIGHT * XMVectorGetX(XMVector3LengthSq(edge));
+
+		AddPlane(simplifier.quadrics[a], unit.x, unit.y, unit.z, distance, weight);
+		AddPlane(simplifier.quadrics[b], unit.x, unit.y, unit.z, distance, weight);
+
+		unsigned int plane = static_cast<unsigned int>(simplifier.planes.size());
+		simplifier.planes.push_back(XMFLOAT4(unit.x, unit.y, unit.z, static_cast<float>(distance)));
+		AddSourcePlane(simplifier, a, plane);
+		AddSourcePlane(simplifier, b, plane);
+		simplifier.flags[a] |= VERTEX_BORDER;
+		simplifier.flags[b] |= VERTEX_BORDER;
+	}
+
+	// Vertices sharing a position are attribute seams (split normals or texture coordinates). Removing one side would
+	// tear the seam, so they stay.
+	std::vector<unsigned int> order(vertex_count);
+	for (unsigned int i = 0; i < vertex_count; i++)
+		order[i] = i;
+
+	std::sort(order.begin(), order.end(), [positions](unsigned int a, unsigned int b)
+	{
+		const XMFLOAT3& pa = positions[a];
+		const XMFLOAT3& pb = positions[b];
+		return pa.x < pb.x || (pa.x == pb.x && (pa.y < pb.y || (pa.y == pb.y && pa.z < pb.z)));
+	});
+
+	for (unsigned int i = 1; i < vertex_count; i++)
+	{
+		const XMFLOAT3& pa = positions[order[i - 1]];
+		const XMFLOAT3& pb = positions[order[i]];
+		if (pa.x == pb.x && pa.y == pb.y && pa.z == pb.z)
+		{
+			simplifier.flags[order[i - 1]] |= VERTEX_LOCKED;
+			simplifier.flags[order[i]] |= VERTEX_LOCKED;
+		}
+	}
+}
+
+// The largest distance from a position to any of a vertex's source planes.
+static float LargestPlaneDistance(const Simplifier& simplifier, unsigned int vertex, const XMFLOAT3& position)
+{
+	float largest = 0.0f;
+	for (unsigned int plane : simplifier.vertex_planes[vertex])
+	{
+		const XMFLOAT4& p = simplifier.planes[plane];
+		largest = (std::max)(largest, fabsf(p.x * position.x + p.y * position.y + p.z * position.z + p.w));
+	}
+
+	return largest;
+}
+
+// Collapse edges cheapest first until the mesh is down to the target triangle count or nothing more can go.
+// The indices are rewritten in place. The quadric cost only orders the collapses; error is raised to the largest
+// distance between a surviving vertex and the source planes of the vertices collapsed into it.
+static void Simplify(Simplifier& simplifier, unsigned int target_triangles, std::vector<unsigned int>& indices, float& error)
+{
+	const XMFLOAT3* positions = simplifier.positions;
+	unsigned int vertex_count = static_cast<unsigned int>(simplifier.quadrics.size());
+	unsigned int triangle_count = static_cast<unsigned int>(indices.size() / 3);
+
+	std::vector<std::vector<unsigned int>> adjacency(vertex_count);
+	for (unsigned int triangle = 0; triangle < triangle_count; triangle++)
+	{
+		for (int k = 0; k < 3; k++)
+			adjacency[indices[triangle * 3 + k]].push_back(triangle);
+	}
+
+	std::vector<bool> triangle_removed(triangle_count, false);
+	std::vector<bool> vertex_removed(vertex_count, false);
+	std::vector<unsigned int> versions(vertex_count, 0);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+	auto contains = [&indices](unsigned int triangle, unsigned int vertex)
+	{
+		return indices[triangle * 3] == vertex || indices[triangle * 3 + 1] == vertex || indices[triangle * 3 + 2] == vertex;
+	};
+
+	auto push = [&](unsigned int from, unsigned int to)
+	{
+		if (simplifier.flags[from] & VERTEX_LOCKED)
+			return;
+
+		// The merged quadric measured at the surviving vertex, normalized to an area weighted mean squared distance.
+		Quadric merged = simplifier.quadrics[from];
+		AddQuadric(merged, simplifier.quadrics[to]);
+		double cost = merged.weight > 0.0 ? (std::max)(Evaluate(merged, positions[to]) / merged.weight, 0.0) : 0.0;
+
+		Collapse collapse = { static_cast<float>(cost), from, to, versions[from], versions[to] };
+		queue.push(collapse);
+	};
+
+	auto push_around = [&](unsigned int vertex)
+	{
+		for (unsigned int triangle : adjacency[vertex])
+		{
+			if (triangle_removed[triangle])
+				continue;
+
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int other = indices[triangle * 3 + k];
+				if (other != vertex)
+				{
+					push(vertex, other);
+					push(other, vertex);
+				}
+			}
+		}
+	};
+
+	auto can_collapse = [&](unsigned int from, unsigned int to)
+	{
+		// Open edges may only shorten along themselves, or the outline would gain a notch.
+		unsigned int shared = 0;
+		for (unsigned int triangle : adjacency[from])
+		{
+			if (!triangle_removed[triangle] && contains(triangle, to))
+				shared++;
+		}
+
+		if (shared == 0 || ((simplifier.flags[from] & VERTEX_BORDER) && shared != 1))
+			return false;
+
+		// Triangles that stay must not fold over or collapse to a sliver.
+		for (unsigned int triangle : adjacency[from])
+		{
+			if (triangle_removed[triangle] || contains(triangle, to))
+				continue;
+
+			XMFLOAT3 corners[3], moved[3];
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int vertex = indices[triangle * 3 + k];
+				corners[k] = positions[vertex];
+				moved[k] = vertex == from ? positions[to] : positions[vertex];
+			}
+
+			XMVECTOR before = TriangleNormal(corners[0], corners[1], corners[2]);
+			XMVECTOR after = TriangleNormal(moved[0], moved[1], moved[2]);
+			float dot = XMVectorGetX(XMVector3Dot(before, after));
+			float lengths = XMVectorGetX(XMVector3Length(before)) * XMVectorGetX(XMVector3Length(after));
+			if (dot <= MINIMUM_NORMAL_DOT * lengths)
+				return false;
+		}
+
+		return true;
+	};
+
+	for (unsigned int vertex = 0; vertex < vertex_count; vertex++)
+	{
+		if (!adjacency[vertex].empty())
+			push_around(vertex);
+	}
+
+	unsigned int live_triangles = triangle_count;
+	while (live_triangles > target_triangles && !queue.empty())
+	{
+		Collapse collapse = queue.top();
+		queue.pop();
+
+		unsigned int from = collapse.from, to = collapse.to;
+		if (vertex_removed[from] || vertex_removed[to] || versions[from] != collapse.from_version || versions[to] != collapse.to_version)
+			continue;
+
+		if (!can_collapse(from, to))
+			continue;
+
+		// Drop the triangles on the edge and move the rest onto the surviving vertex.
+		for (unsigned int triangle : adjacency[from])
+		{
+			if (triangle_removed[triangle])
+				continue;
+
+			if (contains(triangle, to))
+			{
+				triangle_removed[triangle] = true;
+				live_triangles--;
+				continue;
+			}
+
+			for (int k = 0; k < 3; k++)
+			{
+				if (indices[triangle * 3 + k] == from)
+					indices[triangle * 3 + k] = to;
+			}
+			adjacency[to].push_back(triangle);
+		}
+
+		// The surviving vertex takes over the removed vertex's planes. Its own pass through it, so only those can add error.
+		std::vector<unsigned int>& from_planes = simplifier.vertex_planes[from];
+		std::vector<unsigned int>& to_planes = simplifier.vertex_planes[to];
+		error = (std::max)(error, LargestPlaneDistance(simplifier, from, positions[to]));
+		to_planes.insert(to_planes.end(), from_planes.begin(), from_planes.end());
+		std::vector<unsigned int>().swap(from_planes);
+
+		AddQuadric(simplifier.quadrics[to], simplifier.quadrics[from]);
+		vertex_removed[from] = true;
+		adjacency[from].clear();
+		versions[to]++;
+
+		push_around(to);
+	}
+
+	// Compact the surviving triangles.
+	unsigned int written = 0;
+	for (unsigned int triangle = 0; triangle < triangle_count; triangle++)
+	{
+		if (triangle_removed[triangle])
+			continue;
+
+		for (int k = 0; k < 3; k++)
+			indices[written * 3 + k] = indices[triangle * 3 + k];
+		written++;
+	}
+	indices.resize(written * 3);
+}
+
+MeshLod::MeshLod() :
+	centre_(0.0f, 0.0f, 0.0f),
+	radius_(0.0f)
+{
+}
+
+MeshLod::MeshLod(const MeshLod& kOther)
+{
+}
+
+MeshLod::~MeshLod()
+{
+}
+
+bool MeshLod::Initialize(const XMFLOAT3* positions, unsigned int vertex_count, const unsigned int* indices, unsigned int index_count)
+{
+	if (!positions || !indices || vertex_count == 0 || index_count == 0 || index_count % 3 != 0)
+		return false;
+
+	for (unsigned int i = 0; i < index_count; i++)
+	{
+		if (indices[i] >= vertex_count)
+			return false;
+	}
+
+	levels_.clear();
+
+	// Bounding sphere around the centre of the bounding box.
+	XMVECTOR minimum = XMLoadFloat3(&positions[0]);
+	XMVECTOR maximum = minimum;
+	for (unsigned int i = 1; i < vertex_count; i++)
+	{
+		minimum = XMVectorMin(minimum, XMLoadFloat3(&positions[i]));
+		maximum = XMVectorMax(maximum, XMLoadFloat3(&positions[i]));
+	}
+	XMVECTOR centre = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+	XMStoreFloat3(&centre_, centre);
+
+	radius_ = 0.0f;
+	for (unsigned int i = 0; i < vertex_count; i++)
+		radius_ = (std::max)(radius_, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&positions[i]), centre))));
+
+	// Level 0 is the source mesh.
+	MeshLodLevel source;
+	source.indices.assign(indices, indices + index_count);
+	source.vertex_count = vertex_count;
+	source.error = 0.0f;
+	levels_.push_back(source);
+
+	// Simplification works on the non-degenerate triangles.
+	std::vector<unsigned int> working;
+	working.reserve(index_count);
+	for (unsigned int i = 0; i < index_count; i += 3)
+	{
+		if (indices[i] != indices[i + 1] && indices[i + 1] != indices[i + 2] && indices[i] != indices[i + 2])
+			working.insert(working.end(), indices + i, indices + i + 3);
+	}
+
+	Simplifier simplifier;
+	simplifier.positions = positions;
+	BuildQuadrics(simplifier, vertex_count, working);
+
+	// Each level continues from the last, so the error only grows along the chain.
+	float error = 0.0f;
+	while (levels_.size() < MAX_LOD_LEVELS)
+	{
+		unsigned int current = static_cast<unsigned int>(working.size() / 3);
+		unsigned int target = static_cast<unsigned int>(current * LOD_REDUCTION_RATIO);
+		if (target < MINIMUM_LOD_TRIANGLES)
+			break;
+
+		Simplify(simplifier, target, working, error);
+
+		// Stop when locked or badly shaped geometry leaves less than half of the wanted reduction possible.
+		unsigned int simplified = static_cast<unsigned int>(working.size() / 3);
+		if (current - simplified < (current - target) / 2)
+			break;
+
+		MeshLodLevel level;
+		level.indices = working;
+		level.vertex_count = vertex_count;
+		level.error = error;
+		levels_.push_back(level);
+	}
+
+	ReorderVertices(vertex_count);
+
+	return true;
+}
+
+void MeshLod::Shutdown()
+{
+	levels_.clear();
+	vertex_remap_.clear();
+}
+
+unsigned int MeshLod::GetLevelCount() const
+{
+	return static_cast<unsigned int>(levels_.size());
+}
+
+const MeshLodLevel& MeshLod::GetLevel(unsigned int level) const
+{
+	return levels_[level];
+}
+
+const std::vector<unsigned int>& MeshLod::GetVertexRemap() const
+{
+	return vertex_remap_;
+}
+
+const XMFLOAT3& MeshLod::GetCentre() const
+{
+	return centre_;
+}
+
+float MeshLod::GetRadius() const
+{
+	return radius_;
+}
+
+void MeshLod::ReorderVertices(unsigned int vertex_count)
+{
+	// Collapses only remove vertices, so a vertex used by a level is used by every finer level too. Ordering vertices by
+	// the coarsest level using them makes each level's vertices a prefix of the buffer.
+	const unsigned int kUnused = ~0u;
+	std::vector<unsigned int> coarsest(vertex_count, kUnused);
+	for (unsigned int level = 0; level < levels_.size(); level++)
+	{
+		for (unsigned int index : levels_[level].indices)
+			coarsest[index] = level;
+	}
+
+	vertex_remap_.resize(vertex_count);
+	for (unsigned int i = 0; i < vertex_count; i++)
+		vertex_remap_[i] = i;
+
+	// Coarsest first; vertices no triangle uses go last.
+	std::stable_sort(vertex_remap_.begin(), vertex_remap_.end(), [&coarsest](unsigned int a, unsigned int b)
+	{
+		unsigned int level_a = coarsest[a] == kUnused ? 0 : coarsest[a] + 1;
+		unsigned int level_b = coarsest[b] == kUnused ? 0 : coarsest[b] + 1;
+		return level_a > level_b;
+	});
+
+	std::vector<unsigned int> new_index(vertex_count);
+	for (unsigned int i = 0; i < vertex_count; i++)
+		new_index[vertex_remap_[i]] = i;
+
+	for (unsigned int level = 0; level < levels_.size(); level++)
+	{
+		MeshLodLevel& lod = levels_[level];
+		lod.vertex_count = 0;
+		for (unsigned int& index : lod.indices)
+		{
+			index = new_index[index];
+			lod.vertex_count = (std::max)(lod.vertex_count, index + 1);
+		}
+	}
+}
+
+LodSelector::LodSelector() :
+	screen_height_(0),
+	pixel_error_(1.0f)
+{
+}
+
+LodSelector::LodSelector(const LodSelector& kOther)
+{
+}
+
+LodSelector::~LodSelector()
+{
+}
+
+bool LodSelector::Initialize(int screen_height, float pixel_error)
+{
+	if (screen_height <= 0 || pixel_error <= 0.0f)
+		return false;
+
+	screen_height_ = screen_height;
+	pixel_error_ = pixel_error;
+
+	return true;
+}
+
+void LodSelector::Shutdown()
+{
+	meshes_.clear();
+	levels_.clear();
+	scales_.clear();
+	radii_.clear();
+	centre_x_.clear();
+	centre_y_.clear();
+	centre_z_.clear();
+	view_x_.clear();
+	view_y_.clear();
+	view_z_.clear();
+}
+
+int LodSelector::AddObject(const MeshLod* mesh, const XMFLOAT4X4& world)
+{
+	if (!mesh || mesh->GetLevelCount() == 0)
+		return -1;
+
+	meshes_.push_back(mesh);
+	levels_.push_back(0);
+	scales_.push_back(0.0f);
+	radii_.push_back(0.0f);
+	centre_x_.push_back(0.0f);
+	centre_y_.push_back(0.0f);
+	centre_z_.push_back(0.0f);
+	view_x_.push_back(0.0f);
+	view_y_.push_back(0.0f);
+	view_z_.push_back(0.0f);
+
+	unsigned int object = static_cast<unsigned int>(meshes_.size() - 1);
+	SetWorldMatrix(object, world);
+
+	return static_cast<int>(object);
+}
+
+void LodSelector::SetWorldMatrix(unsigned int object, const XMFLOAT4X4& world)
+{
+	// Keep the bounding sphere in world space. The largest axis scale stretches both the radius and the level errors.
+	XMMATRIX matrix = XMLoadFloat4x4(&world);
+	float scale = (std::max)(XMVectorGetX(XMVector3Length(matrix.r[0])), (std::max)(XMVectorGetX(XMVector3Length(matrix.r[1])), XMVectorGetX(XMVector3Length(matrix.r[2]))));
+
+	XMFLOAT3 centre;
+	XMStoreFloat3(&centre, XMVector3TransformCoord(XMLoadFloat3(&meshes_[object]->GetCentre()), matrix));
+
+	scales_[object] = scale;
+	radii_[object] = meshes_[object]->GetRadius() * scale;
+	centre_x_[object] = centre.x;
+	centre_y_[object] = centre.y;
+	centre_z_[object] = centre.z;
+}
+
+void LodSelector::Frame(Direct3D* direct3D, const XMMATRIX& view)
+{
+	unsigned int object_count = GetObjectCount();
+	if (object_count == 0)
+		return;
+
+	// A length of one unit at distance d covers projection._22 / d of the half screen height.
+	XMMATRIX projection;
+	direct3D->GetProjectionMatrix(projection);
+	XMFLOAT4X4 projection_elements;
+	XMStoreFloat4x4(&projection_elements, projection);
+	float pixels_per_unit = projection_elements._22 * screen_height_ * 0.5f;
+
+	// Move every bounding sphere into view space in one batch.
+	XMFLOAT4X4 view_matrix;
+	XMStoreFloat4x4(&view_matrix, view);
+	Float3SoA centres = { centre_x_.data(), centre_y_.data(), centre_z_.data() };
+	Float3SoA view_centres = { view_x_.data(), view_y_.data(), view_z_.data() };
+	BatchTransformPoints(view_matrix, centres, view_centres, object_count);
+
+	for (unsigned int object = 0; object < object_count; object++)
+	{
+		const MeshLod* mesh = meshes_[object];
+		unsigned int level_count = mesh->GetLevelCount();
+
+		// Measure from the nearest point of the sphere; inside it, only the full mesh will do.
+		float distance = sqrtf(view_x_[object] * view_x_[object] + view_y_[object] * view_y_[object] + view_z_[object] * view_z_[object]) - radii_[object];
+		if (distance <= 0.0f)
+		{
+			levels_[object] = 0;
+			continue;
+		}
+
+		// The largest object space error that still projects under the pixel threshold.
+		float allowed = pixel_error_ * distance / (pixels_per_unit * (std::max)(scales_[object], FLT_EPSILON));
+
+		// Refine while the current level is visibly wrong, then coarsen while the next level stays well inside the limit.
+		unsigned int level = (std::min)(levels_[object], level_count - 1);
+		while (level > 0 && mesh->GetLevel(level).error > allowed)
+			level--;
+
+		while (level + 1 < level_count && mesh->GetLevel(level + 1).error <= allowed * LOD_HYSTERESIS)
+			level++;
+
+		levels_[object] = level;
+	}
+}
+
+unsigned int LodSelector::GetLevel(unsigned int object)
+{
+	return levels_[object];
+}
+
+unsigned int LodSelector::GetObjectCount()
+{
+	return static_cast<unsigned int>(meshes_.size());
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+using namespace DirectX;
+
+class Direct3D;
+
+// The most levels built for a mesh, including the source mesh as level 0.
+const unsigned int MAX_LOD_LEVELS = 8;
+
+// Each level aims for this fraction of the triangles of the level before it.
+const float LOD_REDUCTION_RATIO = 0.5f;
+
+// The chain stops before a level would drop below this many triangles.
+const unsigned int MINIMUM_LOD_TRIANGLES = 32;
+
+// A coarser level is only picked once its error fits in this fraction of the allowed error, so objects sitting near a
+// switching distance do not flicker between two levels.
+const float LOD_HYSTERESIS = 0.75f;
+
+struct MeshLodLevel
+{
+	// Triangles of this level, indexing the reordered vertex buffer.
+	std::vector<unsigned int> indices;
+
+	// Vertices used by this level; always a prefix of the reordered vertex buffer.
+	unsigned int vertex_count;
+
+	// Largest distance, in object space units, from a vertex of this level to the plane of any source triangle or open
+	// edge it replaced. Unweighted, so a single far off plane is not averaged away.
+	float error;
+};
+
+class MeshLod
+{
+public:
+	MeshLod();
+	MeshLod(const MeshLod&);
+	~MeshLod();
+
+	// Build the LOD chain from triangle list positions and indices with quadric error edge collapses. Vertices are only
+	// removed, never moved, so every level shares one vertex buffer. It is reordered so coarser levels use a prefix of
+	// it; GetVertexRemap gives the source vertex for each new position, to reorder the other vertex attributes.
+	bool Initialize(const XMFLOAT3*, unsigned int, const unsigned int*, unsigned int);
+	void Shutdown();
+
+	unsigned int GetLevelCount() const;
+	const MeshLodLevel& GetLevel(unsigned int) const;
+	const std::vector<unsigned int>& GetVertexRemap() const;
+
+	// Bounding sphere of the source mesh in object space.
+	const XMFLOAT3& GetCentre() const;
+	float GetRadius() const;
+
+private:
+	void ReorderVertices(unsigned int);
+
+private:
+	std::vector<MeshLodLevel> levels_;
+	std::vector<unsigned int> vertex_remap_;
+	XMFLOAT3 centre_;
+	float radius_;
+};
+
+class LodSelector
+{
+public:
+	LodSelector();
+	LodSelector(const LodSelector&);
+	~LodSelector();
+
+	// Pick levels so the projected error of each object stays under the given number of pixels on a screen of this height.
+	bool Initialize(int, float);
+	void Shutdown();
+
+	// Add an object drawing a mesh with a world matrix. Returns the object index or -1 on failure.
+	int AddObject(const MeshLod*, const XMFLOAT4X4&);
+	void SetWorldMatrix(unsigned int, const XMFLOAT4X4&);
+
+	// Choose every object's level for a camera with the given view matrix and the Direct3D projection matrix.
+	void Frame(Direct3D*, const XMMATRIX&);
+
+	unsigned int GetLevel(unsigned int);
+	unsigned int GetObjectCount();
+
+private:
+	int screen_height_;
+	float pixel_error_;
+	std::vector<const MeshLod*> meshes_;
+	std::vector<unsigned int> levels_;
+	std::vector<float> scales_;
+	std::vector<float> radii_;
+	std::vector<float> centre_x_, centre_y_, centre_z_;
+	std::vector<float> view_x_, view_y_, view_z_;
+};
@@ -0,0 +1,102 @@
+#include "poolAllocator.h"
+
+#include <new>
+
+PoolAllocator::PoolAllocator()
+{
+	for (SizeClass& size_class : classes_)
+		size_class.free_list = 0;
+}
+
+PoolAllocator::PoolAllocator(const PoolAllocator& kOther)
+{
+}
+
+PoolAllocator::~PoolAllocator()
+{
+}
+
+void PoolAllocator::Shutdown()
+{
+	for (SizeClass& size_class : classes_)
+	{
+		std::lock_guard<std::mutex> lock(size_class.mutex);
+		for (void* chunk : size_class.chunks)
+			::operator delete(chunk);
+
+		size_class.chunks.clear();
+		size_class.free_list = 0;
+	}
+}
+
+void* PoolAllocator::Allocate(size_t size)
+{
+	unsigned int index = GetSizeClass(size);
+	if (index >= POOL_SIZE_CLASSES)
+		return ::operator new(size);
+
+	SizeClass& size_class = classes_[index];
+	std::lock_guard<std::mutex> lock(size_class.mutex);
+
+	// Carve a new chunk into blocks when the class has none free.
+	if (!size_class.free_list)
+	{
+		size_t block_size = POOL_MINIMUM_BLOCK_SIZE << index;
+		char* chunk = static_cast<char*>(::operator new(POOL_CHUNK_SIZE));
+		size_class.chunks.push_back(chunk);
+
+		for (size_t offset = POOL_CHUNK_SIZE - block_size; ; offset -= block_size)
+		{
+			FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + offset);
+			block->next = size_class.free_list;
+			size_class.free_list = block;
+			if (offset == 0)
+				break;
+		}
+	}
+
+	FreeBlock* block = size_class.free_list;
+	size_class.free_list = block->next;
+	return block;
+}
+
+void PoolAllocator::Free(void* memory, size_t size)
+{
+	if (!memory)
+		return;
+
+	unsigned int index = GetSizeClass(size);
+	if (index >= POOL_SIZE_CLASSES)
+	{
+		::operator delete(memory);
+		return;
+	}
+
+	SizeClass& size_class = classes_[index];
+	std::lock_guard<std::mutex> lock(size_class.mutex);
+
+	FreeBlock* block = static_cast<FreeBlock*>(memory);
+	block->next = size_class.free_list;
+	size_class.free_list = block;
+}
+
+size_t PoolAllocator::GetReservedBytes()
+{
+	size_t bytes = 0;
+	for (SizeClass& size_class : classes_)
+	{
+		std::lock_guard<std::mutex> lock(size_class.mutex);
+		bytes += size_class.chunks.size() * POOL_CHUNK_SIZE;
+	}
+
+	return bytes;
+}
+
+unsigned int PoolAllocator::GetSizeClass(size_t size)
+{
+	unsigned int index = 0;
+	while (index < POOL_SIZE_CLASSES && (POOL_MINIMUM_BLOCK_SIZE << index) < size)
+		index++;
+
+	return index;
+}
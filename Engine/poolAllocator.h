@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Block sizes double from the smallest class to the largest. Larger requests go to the global heap.
+const size_t POOL_MINIMUM_BLOCK_SIZE = 64;
+const unsigned int POOL_SIZE_CLASSES = 6;
+
+// Blocks are carved from chunks of this size as a class runs out.
+const size_t POOL_CHUNK_SIZE = 64 * 1024;
+
+class PoolAllocator
+{
+public:
+	PoolAllocator();
+	PoolAllocator(const PoolAllocator&);
+	~PoolAllocator();
+
+	// Release every chunk. Blocks still allocated must not be used afterwards.
+	void Shutdown();
+
+	// Allocate and free a block; the size passed to Free must be the size it was allocated with. Safe from any thread.
+	void* Allocate(size_t);
+	void Free(void*, size_t);
+
+	// Bytes held in chunks, whether allocated or free.
+	size_t GetReservedBytes();
+
+private:
+	// Free blocks are linked through their first bytes.
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	struct SizeClass
+	{
+		std::mutex mutex;
+		FreeBlock* free_list;
+		std::vector<void*> chunks;
+	};
+
+	static unsigned int GetSizeClass(size_t);
+
+private:
+	SizeClass classes_[POOL_SIZE_CLASSES];
+};
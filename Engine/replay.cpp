@@ -0,0 +1,300 @@
+#include "replay.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <cstring>
+#include <fstream>
+
+// Record tags in the replay stream.
+enum ReplayTag
+{
+	REPLAY_TAG_FRAME = 0,
+	REPLAY_TAG_KEY_DOWN = 1,
+	REPLAY_TAG_KEY_UP = 2
+};
+
+// Fixed header at the start of a replay file, followed by stream_size bytes of records:
+//   frame:    tag, varint frame time (microseconds)
+//   key down: tag, key, varint microseconds since the previous event
+//   key up:   tag, key, varint microseconds since the previous event
+struct ReplayHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned int seed;
+	unsigned int frame_count;
+	unsigned int event_count;
+	unsigned int stream_size;
+};
+
+static const char kReplayMagic[4] { 'E', 'R', 'P', 'L' };
+
+Replay::Replay() :
+	recording_(false),
+	playing_(false),
+	seed_(0),
+	frame_count_(0),
+	event_count_(0),
+	start_time_(0),
+	timer_frequency_(1),
+	last_timestamp_(0),
+	read_position_(0)
+{
+}
+
+Replay::Replay(const Replay& kOther)
+{
+}
+
+Replay::~Replay()
+{
+}
+
+bool Replay::BeginRecording(const char* path, unsigned int seed)
+{
+	if (recording_ || playing_)
+		return false;
+
+	// Store where the recording is written and the seed the session was started with.
+	path_ = path;
+	seed_ = seed;
+	frame_count_ = 0;
+	event_count_ = 0;
+	stream_.clear();
+
+	// Start the clock event timestamps are measured from.
+	LARGE_INTEGER frequency, now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	timer_frequency_ = frequency.QuadPart;
+	start_time_ = now.QuadPart;
+	last_timestamp_ = 0;
+
+	recording_ = true;
+	return true;
+}
+
+bool Replay::BeginPlayback(const char* path)
+{
+	if (recording_ || playing_)
+		return false;
+
+	// Open the recording.
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	// Read and validate the header.
+	ReplayHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return false;
+
+	if (memcmp(header.magic, kReplayMagic, sizeof(kReplayMagic)) != 0 || header.version != REPLAY_VERSION)
+		return false;
+
+	// Read the whole record stream up front so playback never waits on the disk.
+	stream_.resize(header.stream_size);
+	if (header.stream_size > 0 && !file.read(reinterpret_cast<char*>(stream_.data()), header.stream_size))
+	{
+		stream_.clear();
+		return false;
+	}
+
+	path_ = path;
+	seed_ = header.seed;
+	frame_count_ = header.frame_count;
+	event_count_ = header.event_count;
+	read_position_ = 0;
+	last_timestamp_ = 0;
+	frame_timings_.clear();
+
+	playing_ = true;
+	return true;
+}
+
+bool Replay::Shutdown()
+{
+	bool result = true;
+
+	// Write out the recording.
+	if (recording_)
+	{
+		ReplayHeader header;
+		memcpy(header.magic, kReplayMagic, sizeof(kReplayMagic));
+		header.version = REPLAY_VERSION;
+		header.seed = seed_;
+		header.frame_count = frame_count_;
+		header.event_count = event_count_;
+		header.stream_size = static_cast<unsigned int>(stream_.size());
+
+		std::ofstream file(path_.c_str(), std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(stream_.data()), stream_.size());
+		result = file.good();
+	}
+
+	recording_ = false;
+	playing_ = false;
+	stream_.clear();
+	frame_timings_.clear();
+
+	return result;
+}
+
+bool Replay::IsRecording()
+{
+	return recording_;
+}
+
+bool Replay::IsPlaying()
+{
+	return playing_;
+}
+
+unsigned int Replay::GetSeed()
+{
+	return seed_;
+}
+
+void Replay::RecordMessage(unsigned int message, unsigned int key)
+{
+	if (!recording_)
+		return;
+
+	// Only the keyboard messages that drive the Input object are captured.
+	if (message == WM_KEYDOWN)
+		WriteByte(REPLAY_TAG_KEY_DOWN);
+	else if (message == WM_KEYUP)
+		WriteByte(REPLAY_TAG_KEY_UP);
+	else
+		return;
+
+	// Keys are virtual key codes, which fit in a byte.
+	WriteByte(static_cast<unsigned char>(key));
+
+	unsigned int timestamp = GetTimestamp();
+	WriteVarint(timestamp - last_timestamp_);
+	last_timestamp_ = timestamp;
+
+	event_count_++;
+}
+
+float Replay::RecordFrame(float frame_time)
+{
+	if (!recording_)
+		return frame_time;
+
+	// Frame times are stored in whole microseconds.
+	unsigned int microseconds = static_cast<unsigned int>(frame_time * 1000000.0f + 0.5f);
+	WriteByte(REPLAY_TAG_FRAME);
+	WriteVarint(microseconds);
+	frame_count_++;
+
+	// Return the stored value so the recorded session simulates exactly what playback will.
+	return static_cast<float>(microseconds) / 1000000.0f;
+}
+
+bool Replay::ReadFrame(std::vector<ReplayEvent>& events, float& frame_time)
+{
+	events.clear();
+	if (!playing_)
+		return false;
+
+	// Collect events until the record that closes the frame.
+	unsigned char tag;
+	while (ReadByte(tag))
+	{
+		if (tag == REPLAY_TAG_FRAME)
+		{
+			unsigned int microseconds;
+			if (!ReadVarint(microseconds))
+				return false;
+
+			frame_time = static_cast<float>(microseconds) / 1000000.0f;
+			return true;
+		}
+
+		unsigned char key;
+		unsigned int delta;
+		if (tag > REPLAY_TAG_KEY_UP || !ReadByte(key) || !ReadVarint(delta))
+			return false;
+
+		ReplayEvent event;
+		event.message = tag == REPLAY_TAG_KEY_DOWN ? WM_KEYDOWN : WM_KEYUP;
+		event.key = key;
+		event.timestamp = last_timestamp_ + delta;
+		last_timestamp_ = event.timestamp;
+		events.push_back(event);
+	}
+
+	// Events after the final frame record are dropped; they never reached a frame in the original session.
+	return false;
+}
+
+void Replay::AddFrameTiming(double milliseconds)
+{
+	frame_timings_.push_back(milliseconds);
+}
+
+bool Replay::WriteTimings(const char* path)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+		return false;
+
+	// Write one line per replayed frame.
+	file << "frame,milliseconds\n";
+	for (size_t i = 0; i < frame_timings_.size(); i++)
+		file << i << "," << frame_timings_[i] << "\n";
+
+	return file.good();
+}
+
+void Replay::WriteByte(unsigned char value)
+{
+	stream_.push_back(value);
+}
+
+void Replay::WriteVarint(unsigned int value)
+{
+	// Seven bits per byte, with the top bit set on every byte but the last.
+	while (value >= 0x80)
+	{
+		stream_.push_back(static_cast<unsigned char>(value | 0x80));
+		value >>= 7;
+	}
+	stream_.push_back(static_cast<unsigned char>(value));
+}
+
+bool Replay::ReadByte(unsigned char& value)
+{
+	if (read_position_ >= stream_.size())
+		return false;
+
+	value = stream_[read_position_++];
+	return true;
+}
+
+bool Replay::ReadVarint(unsigned int& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		unsigned char byte;
+		if (!ReadByte(byte))
+			return false;
+
+		value |= static_cast<unsigned int>(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+unsigned int Replay::GetTimestamp()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return static_cast<unsigned int>((now.QuadPart - start_time_) * 1000000 / timer_frequency_);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Bumped whenever the layout of a replay file changes; older files are rejected.
+const unsigned int REPLAY_VERSION = 1;
+
+// A window message delivered to System::MessageHandler during a recorded frame.
+struct ReplayEvent
+{
+	unsigned int message;
+	unsigned int key;
+	unsigned int timestamp;	// Microseconds since the recording started.
+};
+
+class Replay
+{
+public:
+	Replay();
+	Replay(const Replay&);
+	~Replay();
+
+	// Start capturing input and frame times; the file is written when the replay is shut down.
+	bool BeginRecording(const char*, unsigned int);
+
+	// Load a recording to play back.
+	bool BeginPlayback(const char*);
+
+	// Write out any recording in progress and release the replay data.
+	bool Shutdown();
+
+	bool IsRecording();
+	bool IsPlaying();
+	unsigned int GetSeed();
+
+	// Capture a keyboard message, and the end of a frame with its frame time (seconds).
+	// RecordFrame returns the frame time as stored so the live session runs with exactly what playback will see.
+	void RecordMessage(unsigned int, unsigned int);
+	float RecordFrame(float);
+
+	// Read the events and frame time of the next recorded frame. Returns false when the recording is exhausted.
+	bool ReadFrame(std::vector<ReplayEvent>&, float&);
+
+	// Collect the measured cost of each replayed frame (milliseconds) and write them out as CSV.
+	void AddFrameTiming(double);
+	bool WriteTimings(const char*);
+
+private:
+	void WriteByte(unsigned char);
+	void WriteVarint(unsigned int);
+	bool ReadByte(unsigned char&);
+	bool ReadVarint(unsigned int&);
+	unsigned int GetTimestamp();
+
+private:
+	bool recording_;
+	bool playing_;
+	std::string path_;
+	unsigned int seed_;
+	unsigned int frame_count_;
+	unsigned int event_count_;
+	long long start_time_;
+	long long timer_frequency_;
+	unsigned int last_timestamp_;
+
+	std::vector<unsigned char> stream_;
+	size_t read_position_;
+
+	std::vector<double> frame_timings_;
+};
@@ -0,0 +1,409 @@
+#include "sceneFile.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+static const char SCENE_FILE_MAGIC[4] { 'E', 'S', 'C', 'N' };
+
+static unsigned long long AlignSceneOffset(unsigned long long offset)
+{
+	return (offset + SCENE_FILE_ALIGNMENT - 1) & ~static_cast<unsigned long long>(SCENE_FILE_ALIGNMENT - 1);
+}
+
+// An array is valid when it is aligned and lies wholly inside the file after the header.
+template <typename T>
+static bool IsArrayInFile(const SceneOffset<T>& reference, unsigned long long count, unsigned long long file_size)
+{
+	if (reference.offset % SCENE_FILE_ALIGNMENT != 0 || reference.offset < sizeof(SceneFileHeader) || reference.offset > file_size)
+		return false;
+
+	return count <= (file_size - reference.offset) / sizeof(T);
+}
+
+// A byte range taken by one section of the file, used to check that sections do not overlap.
+struct SceneSection
+{
+	unsigned long long offset, size;
+};
+
+template <typename T>
+static SceneSection GetSection(const SceneOffset<T>& reference, unsigned long long count)
+{
+	SceneSection section = { reference.offset, count * sizeof(T) };
+	return section;
+}
+
+template <typename T>
+static void Resolve(SceneOffset<T>& reference, unsigned char* base)
+{
+	reference.pointer = reinterpret_cast<T*>(base + reference.offset);
+}
+
+SceneFile::SceneFile()
+{
+	header_ = 0;
+}
+
+SceneFile::SceneFile(const SceneFile& kOther)
+{
+}
+
+SceneFile::~SceneFile()
+{
+}
+
+bool SceneFile::Initialize(const char* path)
+{
+	if (header_)
+		return false;
+
+	// Open the file and find its size.
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < static_cast<long long>(sizeof(SceneFileHeader)) ||
+		static_cast<unsigned long long>(file_size.QuadPart) > static_cast<size_t>(-1))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	// Map the whole file copy on write. Pages are read straight from the file cache until they are written, and a
+	// written page becomes a private copy. The view keeps the mapping and file open, so both handles can go now.
+	HANDLE mapping = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+	CloseHandle(file);
+	if (!mapping)
+		return false;
+
+	unsigned char* view = static_cast<unsigned char*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+	CloseHandle(mapping);
+	if (!view)
+		return false;
+
+	// Check every offset before any is followed.
+	if (!Validate(view, static_cast<unsigned long long>(file_size.QuadPart)))
+	{
+		UnmapViewOfFile(view);
+		return false;
+	}
+
+	FixUp(view);
+	header_ = reinterpret_cast<SceneFileHeader*>(view);
+	return true;
+}
+
+void SceneFile::Shutdown()
+{
+	// Release the mapping, and with it any pages that were copied.
+	if (header_)
+	{
+		UnmapViewOfFile(header_);
+		header_ = 0;
+	}
+}
+
+unsigned int SceneFile::GetEntityCount()
+{
+	return header_ ? header_->entity_count : 0;
+}
+
+unsigned int SceneFile::GetResourceCount()
+{
+	return header_ ? header_->resource_count : 0;
+}
+
+const unsigned int* SceneFile::GetIds()
+{
+	return header_->ids.pointer;
+}
+
+const unsigned int* SceneFile::GetParents()
+{
+	return header_->parents.pointer;
+}
+
+Float3SoA SceneFile::GetPositions()
+{
+	Float3SoA positions = { header_->position_x.pointer, header_->position_y.pointer, header_->position_z.pointer };
+	return positions;
+}
+
+QuaternionSoA SceneFile::GetRotations()
+{
+	QuaternionSoA rotations = { header_->rotation_x.pointer, header_->rotation_y.pointer, header_->rotation_z.pointer, header_->rotation_w.pointer };
+	return rotations;
+}
+
+Float3SoA SceneFile::GetScales()
+{
+	Float3SoA scales = { header_->scale_x.pointer, header_->scale_y.pointer, header_->scale_z.pointer };
+	return scales;
+}
+
+const unsigned int* SceneFile::GetMeshes()
+{
+	return header_->meshes.pointer;
+}
+
+const unsigned int* SceneFile::GetMaterials()
+{
+	return header_->materials.pointer;
+}
+
+const SceneResource& SceneFile::GetResource(unsigned int resource)
+{
+	return header_->resources.pointer[resource];
+}
+
+bool SceneFile::Validate(const unsigned char* data, unsigned long long size)
+{
+	const SceneFileHeader& header = *reinterpret_cast<const SceneFileHeader*>(data);
+
+	if (memcmp(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC)) != 0 || header.version != SCENE_FILE_VERSION || header.file_size != size)
+		return false;
+
+	// Every array has to sit inside the file.
+	unsigned long long entities = header.entity_count;
+	const SceneOffset<float>* transforms[] = { &header.position_x, &header.position_y, &header.position_z, &header.rotation_x, &header.rotation_y,
+		&header.rotation_z, &header.rotation_w, &header.scale_x, &header.scale_y, &header.scale_z };
+	for (const SceneOffset<float>* transform : transforms)
+	{
+		if (!IsArrayInFile(*transform, entities, size))
+			return false;
+	}
+
+	if (!IsArrayInFile(header.ids, entities, size) || !IsArrayInFile(header.parents, entities, size) || !IsArrayInFile(header.meshes, entities, size) ||
+		!IsArrayInFile(header.materials, entities, size) || !IsArrayInFile(header.resources, header.resource_count, size) ||
+		!IsArrayInFile(header.strings, header.string_size, size))
+		return false;
+
+	// No two sections may share bytes, or fixing up the resource table could rewrite data another section reads.
+	// Empty sections take no bytes and are left out.
+	SceneSection sections[16];
+	unsigned int section_count = 0;
+	for (const SceneOffset<float>* transform : transforms)
+		sections[section_count++] = GetSection(*transform, entities);
+	sections[section_count++] = GetSection(header.ids, entities);
+	sections[section_count++] = GetSection(header.parents, entities);
+	sections[section_count++] = GetSection(header.meshes, entities);
+	sections[section_count++] = GetSection(header.materials, entities);
+	sections[section_count++] = GetSection(header.resources, header.resource_count);
+	sections[section_count++] = GetSection(header.strings, header.string_size);
+
+	SceneSection* sections_end = std::remove_if(sections, sections + section_count, [](const SceneSection& section) { return section.size == 0; });
+	std::sort(sections, sections_end, [](const SceneSection& a, const SceneSection& b) { return a.offset < b.offset; });
+	for (SceneSection* section = sections; section + 1 < sections_end; section++)
+	{
+		if (section->offset + section->size > section[1].offset)
+			return false;
+	}
+
+	// Parents come before their children and resource references are in range.
+	const unsigned int* parents = reinterpret_cast<const unsigned int*>(data + header.parents.offset);
+	const unsigned int* meshes = reinterpret_cast<const unsigned int*>(data + header.meshes.offset);
+	const unsigned int* materials = reinterpret_cast<const unsigned int*>(data + header.materials.offset);
+	for (unsigned int entity = 0; entity < header.entity_count; entity++)
+	{
+		if (parents[entity] != SCENE_NO_PARENT && parents[entity] >= entity)
+			return false;
+
+		if (meshes[entity] != SCENE_NO_RESOURCE && meshes[entity] >= header.resource_count)
+			return false;
+
+		if (materials[entity] != SCENE_NO_RESOURCE && materials[entity] >= header.resource_count)
+			return false;
+	}
+
+	// Resource paths are zero terminated strings inside the string section.
+	const SceneResource* resources = reinterpret_cast<const SceneResource*>(data + header.resources.offset);
+	unsigned long long strings_end = header.strings.offset + header.string_size;
+	for (unsigned int resource = 0; resource < header.resource_count; resource++)
+	{
+		const SceneResource& entry = resources[resource];
+		if (entry.type >= SCENE_RESOURCE_TYPE_COUNT || entry.path.offset < header.strings.offset || entry.path.offset >= strings_end ||
+			entry.path_length >= strings_end - entry.path.offset || data[entry.path.offset + entry.path_length] != 0)
+			return false;
+	}
+
+	return true;
+}
+
+void SceneFile::FixUp(unsigned char* data)
+{
+	// Only the header and the resource table hold offsets, so they are the only pages copied.
+	SceneFileHeader& header = *reinterpret_cast<SceneFileHeader*>(data);
+	Resolve(header.ids, data);
+	Resolve(header.parents, data);
+	Resolve(header.position_x, data);
+	Resolve(header.position_y, data);
+	Resolve(header.position_z, data);
+	Resolve(header.rotation_x, data);
+	Resolve(header.rotation_y, data);
+	Resolve(header.rotation_z, data);
+	Resolve(header.rotation_w, data);
+	Resolve(header.scale_x, data);
+	Resolve(header.scale_y, data);
+	Resolve(header.scale_z, data);
+	Resolve(header.meshes, data);
+	Resolve(header.materials, data);
+	Resolve(header.resources, data);
+	Resolve(header.strings, data);
+
+	for (unsigned int resource = 0; resource < header.resource_count; resource++)
+		Resolve(header.resources.pointer[resource].path, data);
+}
+
+SceneWriter::SceneWriter()
+{
+}
+
+SceneWriter::SceneWriter(const SceneWriter& kOther)
+{
+}
+
+SceneWriter::~SceneWriter()
+{
+}
+
+int SceneWriter::AddResource(SceneResourceType type, const char* path)
+{
+	if (type >= SCENE_RESOURCE_TYPE_COUNT || !path)
+		return -1;
+
+	resource_types_.push_back(type);
+	resource_paths_.push_back(path);
+	return static_cast<int>(resource_paths_.size() - 1);
+}
+
+int SceneWriter::AddEntity(unsigned int id, unsigned int parent, const XMFLOAT3& position, const XMFLOAT4& rotation, const XMFLOAT3& scale, unsigned int mesh, unsigned int material)
+{
+	unsigned int resource_count = static_cast<unsigned int>(resource_paths_.size());
+	if ((parent != SCENE_NO_PARENT && parent >= ids_.size()) || (mesh != SCENE_NO_RESOURCE && mesh >= resource_count) ||
+		(material != SCENE_NO_RESOURCE && material >= resource_count))
+		return -1;
+
+	ids_.push_back(id);
+	parents_.push_back(parent);
+	position_x_.push_back(position.x);
+	position_y_.push_back(position.y);
+	position_z_.push_back(position.z);
+	rotation_x_.push_back(rotation.x);
+	rotation_y_.push_back(rotation.y);
+	rotation_z_.push_back(rotation.z);
+	rotation_w_.push_back(rotation.w);
+	scale_x_.push_back(scale.x);
+	scale_y_.push_back(scale.y);
+	scale_z_.push_back(scale.z);
+	meshes_.push_back(mesh);
+	materials_.push_back(material);
+	return static_cast<int>(ids_.size() - 1);
+}
+
+bool SceneWriter::Write(const char* path)
+{
+	unsigned int entity_count = static_cast<unsigned int>(ids_.size());
+	unsigned int resource_count = static_cast<unsigned int>(resource_paths_.size());
+
+	SceneFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC));
+	header.version = SCENE_FILE_VERSION;
+	header.entity_count = entity_count;
+	header.resource_count = resource_count;
+
+	// Give each array the next aligned offset after the header, in the order they are declared.
+	unsigned long long end = sizeof(header);
+	auto place = [&end](unsigned long long bytes)
+	{
+		unsigned long long offset = AlignSceneOffset(end);
+		end = offset + bytes;
+		return offset;
+	};
+
+	struct TransformArray
+	{
+		const std::vector<float>* source;
+		SceneOffset<float>* reference;
+	};
+	TransformArray transforms[] = { { &position_x_, &header.position_x }, { &position_y_, &header.position_y }, { &position_z_, &header.position_z },
+		{ &rotation_x_, &header.rotation_x }, { &rotation_y_, &header.rotation_y }, { &rotation_z_, &header.rotation_z }, { &rotation_w_, &header.rotation_w },
+		{ &scale_x_, &header.scale_x }, { &scale_y_, &header.scale_y }, { &scale_z_, &header.scale_z } };
+
+	header.ids.offset = place(entity_count * sizeof(unsigned int));
+	header.parents.offset = place(entity_count * sizeof(unsigned int));
+	for (TransformArray& transform : transforms)
+		transform.reference->offset = place(entity_count * sizeof(float));
+	header.meshes.offset = place(entity_count * sizeof(unsigned int));
+	header.materials.offset = place(entity_count * sizeof(unsigned int));
+	header.resources.offset = place(resource_count * sizeof(SceneResource));
+
+	// Pack the resource paths, each with its terminating zero.
+	std::vector<SceneResource> resources(resource_count);
+	std::string strings;
+	for (unsigned int resource = 0; resource < resource_count; resource++)
+	{
+		resources[resource].type = resource_types_[resource];
+		resources[resource].path_length = static_cast<unsigned int>(resource_paths_[resource].size());
+		resources[resource].path.offset = strings.size();
+		strings.append(resource_paths_[resource]);
+		strings.push_back('\0');
+	}
+
+	header.string_size = static_cast<unsigned int>(strings.size());
+	header.strings.offset = place(strings.size());
+	for (SceneResource& resource : resources)
+		resource.path.offset += header.strings.offset;
+
+	header.file_size = end;
+
+	// Build the file image and write it in one go.
+	std::vector<unsigned char> image(static_cast<size_t>(header.file_size), 0);
+	memcpy(image.data(), &header, sizeof(header));
+	if (entity_count > 0)
+	{
+		memcpy(image.data() + header.ids.offset, ids_.data(), entity_count * sizeof(unsigned int));
+		memcpy(image.data() + header.parents.offset, parents_.data(), entity_count * sizeof(unsigned int));
+		for (TransformArray& transform : transforms)
+			memcpy(image.data() + transform.reference->offset, transform.source->data(), entity_count * sizeof(float));
+		memcpy(image.data() + header.meshes.offset, meshes_.data(), entity_count * sizeof(unsigned int));
+		memcpy(image.data() + header.materials.offset, materials_.data(), entity_count * sizeof(unsigned int));
+	}
+
+	if (resource_count > 0)
+	{
+		memcpy(image.data() + header.resources.offset, resources.data(), resource_count * sizeof(SceneResource));
+		memcpy(image.data() + header.strings.offset, strings.data(), strings.size());
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	file.write(reinterpret_cast<const char*>(image.data()), image.size());
+	return file.good();
+}
+
+void SceneWriter::Shutdown()
+{
+	ids_.clear();
+	parents_.clear();
+	position_x_.clear();
+	position_y_.clear();
+	position_z_.clear();
+	rotation_x_.clear();
+	rotation_y_.clear();
+	rotation_z_.clear();
+	rotation_w_.clear();
+	scale_x_.clear();
+	scale_y_.clear();
+	scale_z_.clear();
+	meshes_.clear();
+	materials_.clear();
+	resource_types_.clear();
+	resource_paths_.clear();
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+#include "batchMath.h"
+using namespace DirectX;
+
+// Bumped whenever the layout of a scene file changes; older files are rejected.
+const unsigned int SCENE_FILE_VERSION = 1;
+
+// Every array in a scene file starts on this boundary so it can be read with aligned vector loads once mapped.
+const unsigned int SCENE_FILE_ALIGNMENT = 16;
+
+// Parent of a root entity, and the reference of an entity without a mesh or material.
+const unsigned int SCENE_NO_PARENT = 0xffffffff;
+const unsigned int SCENE_NO_RESOURCE = 0xffffffff;
+
+enum SceneResourceType
+{
+	SCENE_RESOURCE_MESH = 0,
+	SCENE_RESOURCE_MATERIAL = 1,
+	SCENE_RESOURCE_TEXTURE = 2,
+	SCENE_RESOURCE_TYPE_COUNT
+};
+
+// A reference stored in the file as a byte offset from the start of the file, and replaced in place by the pointer it
+// refers to when the file is loaded. Always 64 bits so the layout is the same for every build.
+template <typename T>
+union SceneOffset
+{
+	unsigned long long offset;
+	T* pointer;
+};
+
+// A resource the scene refers to by path; loading the resource itself is left to its owner.
+struct SceneResource
+{
+	SceneOffset<const char> path;
+	unsigned int type;
+	unsigned int path_length;	// Characters before the path's terminating zero.
+};
+
+// The start of a scene file. Entities are stored as one array per field, the same structure of arrays layout the batch
+// math works on, followed by the resource table and the strings its paths point into. Parents always come before their
+// children, so transforms can be resolved in a single pass.
+struct SceneFileHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned long long file_size;
+	unsigned int entity_count;
+	unsigned int resource_count;
+	unsigned int string_size;
+	unsigned int padding;
+
+	SceneOffset<unsigned int> ids;
+	SceneOffset<unsigned int> parents;
+	SceneOffset<float> position_x, position_y, position_z;
+	SceneOffset<float> rotation_x, rotation_y, rotation_z, rotation_w;
+	SceneOffset<float> scale_x, scale_y, scale_z;
+	SceneOffset<unsigned int> meshes;
+	SceneOffset<unsigned int> materials;
+	SceneOffset<SceneResource> resources;
+	SceneOffset<char> strings;
+};
+
+class SceneFile
+{
+public:
+	SceneFile();
+	SceneFile(const SceneFile&);
+	~SceneFile();
+
+	// Map a scene file copy on write, validate it and turn its offsets into pointers. Nothing is parsed or copied: the
+	// arrays are used where they sit in the mapping, and only the pages holding offsets are ever privately copied.
+	bool Initialize(const char*);
+	void Shutdown();
+
+	unsigned int GetEntityCount();
+	unsigned int GetResourceCount();
+
+	// The entity arrays, usable directly with the batch math. The transforms may be animated in place; the mapping is
+	// private, so changes never reach the file.
+	const unsigned int* GetIds();
+	const unsigned int* GetParents();
+	Float3SoA GetPositions();
+	QuaternionSoA GetRotations();
+	Float3SoA GetScales();
+	const unsigned int* GetMeshes();
+	const unsigned int* GetMaterials();
+
+	const SceneResource& GetResource(unsigned int);
+
+private:
+	bool Validate(const unsigned char*, unsigned long long);
+	void FixUp(unsigned char*);
+
+private:
+	SceneFileHeader* header_;
+};
+
+class SceneWriter
+{
+public:
+	SceneWriter();
+	SceneWriter(const SceneWriter&);
+	~SceneWriter();
+
+	// Add a resource by type and path. Returns its index for entities to refer to, or -1 on failure.
+	int AddResource(SceneResourceType, const char*);
+
+	// Add an entity with its parent, local transform and resources (SCENE_NO_PARENT and SCENE_NO_RESOURCE for none).
+	// The parent has to be added first. Returns the entity index or -1 on failure.
+	int AddEntity(unsigned int, unsigned int, const XMFLOAT3&, const XMFLOAT4&, const XMFLOAT3&, unsigned int, unsigned int);
+
+	// Lay the scene out as it will sit in memory and write it to a file.
+	bool Write(const char*);
+	void Shutdown();
+
+private:
+	std::vector<unsigned int> ids_;
+	std::vector<unsigned int> parents_;
+	std::vector<float> position_x_, position_y_, position_z_;
+	std::vector<float> rotation_x_, rotation_y_, rotation_z_, rotation_w_;
+	std::vector<float> scale_x_, scale_y_, scale_z_;
+	std::vector<unsigned int> meshes_;
+	std::vector<unsigned int> materials_;
+	std::vector<unsigned int> resource_types_;
+	std::vector<std::string> resource_paths_;
+};
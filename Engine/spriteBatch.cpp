@@ -0,0 +1,466 @@
+#include "spriteBatch.h"
+
+#include <algorithm>
+#include <d3dcompiler.h>
+#include "direct3D.h"
+#include "font.h"
+
+// Sprites are positioned in pixels and moved into the orthographic projection's space by a single matrix.
+static const char SPRITE_SHADER[] =
+	"cbuffer MatrixBuffer : register(b0)\n"
+	"{\n"
+	"	matrix screen_to_clip;\n"
+	"};\n"
+	"Texture2D sprite_texture : register(t0);\n"
+	"SamplerState sprite_sampler : register(s0);\n"
+	"struct VertexInput\n"
+	"{\n"
+	"	float2 position : POSITION;\n"
+	"	float2 tex : TEXCOORD0;\n"
+	"	float4 colour : COLOR;\n"
+	"};\n"
+	"struct PixelInput\n"
+	"{\n"
+	"	float4 position : SV_POSITION;\n"
+	"	float2 tex : TEXCOORD0;\n"
+	"	float4 colour : COLOR;\n"
+	"};\n"
+	"PixelInput SpriteVertexShader(VertexInput input)\n"
+	"{\n"
+	"	PixelInput output;\n"
+	"	output.position = mul(float4(input.position, 0.0f, 1.0f), screen_to_clip);\n"
+	"	output.tex = input.tex;\n"
+	"	output.colour = input.colour;\n"
+	"	return output;\n"
+	"}\n"
+	"float4 SpritePixelShader(PixelInput input) : SV_TARGET\n"
+	"{\n"
+	"	return sprite_texture.Sample(sprite_sampler, input.tex) * input.colour;\n"
+	"}\n";
+
+// Sort keys hold the layer in the top 16 bits, the texture slot in the next 16 and the sprite index in the low 32.
+static const int SPRITE_LAYER_BIAS = 32768;
+
+static unsigned int PackColour(const XMFLOAT4& colour)
+{
+	// R8G8B8A8_UNORM: red in the lowest byte.
+	unsigned int red = static_cast<unsigned int>((std::min)((std::max)(colour.x, 0.0f), 1.0f) * 255.0f + 0.5f);
+	unsigned int green = static_cast<unsigned int>((std::min)((std::max)(colour.y, 0.0f), 1.0f) * 255.0f + 0.5f);
+	unsigned int blue = static_cast<unsigned int>((std::min)((std::max)(colour.z, 0.0f), 1.0f) * 255.0f + 0.5f);
+	unsigned int alpha = static_cast<unsigned int>((std::min)((std::max)(colour.w, 0.0f), 1.0f) * 255.0f + 0.5f);
+	return red | (green << 8) | (blue << 16) | (alpha << 24);
+}
+
+SpriteBatch::SpriteBatch() :
+	screen_width_(0),
+	screen_height_(0),
+	vertex_shader_(0),
+	pixel_shader_(0),
+	layout_(0),
+	sample_state_(0),
+	vertex_buffer_(0),
+	index_buffer_(0),
+	matrix_buffer_(0),
+	white_texture_(0),
+	white_texture_view_(0),
+	draw_count_(0)
+{
+}
+
+SpriteBatch::SpriteBatch(const SpriteBatch& kOther)
+{
+}
+
+SpriteBatch::~SpriteBatch()
+{
+}
+
+bool SpriteBatch::Initialize(Direct3D* direct3D, int screen_width, int screen_height)
+{
+	screen_width_ = screen_width;
+	screen_height_ = screen_height;
+
+	if (!InitializeShaders(direct3D->GetDevice()))
+		return false;
+
+	if (!InitializeBuffers(direct3D->GetDevice()))
+		return false;
+
+	// Create the constant buffer holding the screen to clip space matrix.
+	if (!direct3D->CreateConstantBuffer(sizeof(XMFLOAT4X4), &matrix_buffer_))
+		return false;
+
+	sprites_.reserve(SPRITE_BATCH_SIZE);
+	sort_keys_.reserve(SPRITE_BATCH_SIZE);
+
+	return true;
+}
+
+void SpriteBatch::Shutdown()
+{
+	if (white_texture_view_)
+	{
+		white_texture_view_->Release();
+		white_texture_view_ = 0;
+	}
+
+	if (white_texture_)
+	{
+		white_texture_->Release();
+		white_texture_ = 0;
+	}
+
+	if (matrix_buffer_)
+	{
+		matrix_buffer_->Release();
+		matrix_buffer_ = 0;
+	}
+
+	if (index_buffer_)
+	{
+		index_buffer_->Release();
+		index_buffer_ = 0;
+	}
+
+	if (vertex_buffer_)
+	{
+		vertex_buffer_->Release();
+		vertex_buffer_ = 0;
+	}
+
+	if (sample_state_)
+	{
+		sample_state_->Release();
+		sample_state_ = 0;
+	}
+
+	if (layout_)
+	{
+		layout_->Release();
+		layout_ = 0;
+	}
+
+	if (pixel_shader_)
+	{
+		pixel_shader_->Release();
+		pixel_shader_ = 0;
+	}
+
+	if (vertex_shader_)
+	{
+		vertex_shader_->Release();
+		vertex_shader_ = 0;
+	}
+
+	sprites_.clear();
+	sort_keys_.clear();
+	textures_.clear();
+}
+
+void SpriteBatch::Begin()
+{
+	sprites_.clear();
+	sort_keys_.clear();
+	textures_.clear();
+}
+
+void SpriteBatch::Draw(ID3D11ShaderResourceView* texture, const XMFLOAT4& destination, const XMFLOAT4& uv, const XMFLOAT4& colour, int layer)
+{
+	if (!texture)
+		texture = white_texture_view_;
+
+	Sprite sprite;
+	sprite.destination = destination;
+	sprite.uv = uv;
+	sprite.colour = PackColour(colour);
+	sprite.texture = texture;
+
+	unsigned long long biased_layer = static_cast<unsigned long long>((std::min)((std::max)(layer + SPRITE_LAYER_BIAS, 0), 0xffff));
+	unsigned long long key = (biased_layer << 48) | (static_cast<unsigned long long>(FindTextureSlot(texture)) << 32) | sprites_.size();
+
+	sprites_.push_back(sprite);
+	sort_keys_.push_back(key);
+}
+
+void SpriteBatch::DrawString(Font* font, const wchar_t* text, float x, float y, const XMFLOAT4& colour, int layer)
+{
+	ID3D11ShaderResourceView* texture = font->GetTexture();
+	float pen_x = x, pen_y = y;
+
+	for (const wchar_t* character = text; *character; character++)
+	{
+		if (*character == L'\n')
+		{
+			pen_x = x;
+			pen_y += font->GetLineHeight();
+			continue;
+		}
+
+		const Glyph* glyph = font->GetGlyph(*character);
+		if (!glyph)
+			continue;
+
+		if (glyph->region.width > 0)
+		{
+			XMFLOAT4 destination(pen_x + glyph->offset_x, pen_y + glyph->offset_y, static_cast<float>(glyph->region.width), static_cast<float>(glyph->region.height));
+			Draw(texture, destination, glyph->region.uv, colour, layer);
+		}
+
+		pen_x += glyph->advance;
+	}
+}
+
+void SpriteBatch::Sort()
+{
+	// The sprite index in the low bits keeps submission order within a layer and texture.
+	std::sort(sort_keys_.begin(), sort_keys_.end());
+}
+
+bool SpriteBatch::End(Direct3D* direct3D)
+{
+	draw_count_ = 0;
+	if (sprites_.empty())
+		return true;
+
+	Sort();
+
+	// 2D sprites are drawn over everything with alpha blending.
+	direct3D->TurnZBufferOff();
+	direct3D->TurnOnAlphaBlending();
+
+	bool result = RenderSprites(direct3D);
+
+	direct3D->TurnOffAlphaBlending();
+	direct3D->TurnZBufferOn();
+
+	Begin();
+
+	return result;
+}
+
+unsigned int SpriteBatch::GetDrawCount()
+{
+	return draw_count_;
+}
+
+bool SpriteBatch::InitializeShaders(ID3D11Device* device)
+{
+	ID3DBlob* vertex_shader_buffer = 0;
+	ID3DBlob* pixel_shader_buffer = 0;
+	ID3DBlob* error_message = 0;
+
+	// Compile the vertex shader code.
+	if (FAILED(D3DCompile(SPRITE_SHADER, sizeof(SPRITE_SHADER) - 1, "SpriteBatch", 0, 0, "SpriteVertexShader", "vs_4_0", D3DCOMPILE_ENABLE_STRICTNESS, 0, &vertex_shader_buffer, &error_message)))
+	{
+		if (error_message)
+		{
+			OutputDebugStringA(static_cast<const char*>(error_message->GetBufferPointer()));
+			error_message->Release();
+		}
+		return false;
+	}
+
+	// Compile the pixel shader code.
+	if (FAILED(D3DCompile(SPRITE_SHADER, sizeof(SPRITE_SHADER) - 1, "SpriteBatch", 0, 0, "SpritePixelShader", "ps_4_0", D3DCOMPILE_ENABLE_STRICTNESS, 0, &pixel_shader_buffer, &error_message)))
+	{
+		if (error_message)
+		{
+			OutputDebugStringA(static_cast<const char*>(error_message->GetBufferPointer()));
+			error_message->Release();
+		}
+		vertex_shader_buffer->Release();
+		return false;
+	}
+
+	// Create the shaders from the buffers.
+	bool result = SUCCEEDED(device->CreateVertexShader(vertex_shader_buffer->GetBufferPointer(), vertex_shader_buffer->GetBufferSize(), 0, &vertex_shader_)) &&
+		SUCCEEDED(device->CreatePixelShader(pixel_shader_buffer->GetBufferPointer(), pixel_shader_buffer->GetBufferSize(), 0, &pixel_shader_));
+
+	// Create the vertex input layout to match SpriteVertex.
+	D3D11_INPUT_ELEMENT_DESC polygon_layout[3] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+	result = result && SUCCEEDED(device->CreateInputLayout(polygon_layout, 3, vertex_shader_buffer->GetBufferPointer(), vertex_shader_buffer->GetBufferSize(), &layout_));
+
+	// Release the shader buffers now the shaders and layout exist.
+	vertex_shader_buffer->Release();
+	pixel_shader_buffer->Release();
+	if (!result)
+		return false;
+
+	// Create a clamped bilinear sampler so atlas neighbours never bleed in.
+	D3D11_SAMPLER_DESC sampler_desc;
+	ZeroMemory(&sampler_desc, sizeof(sampler_desc));
+	sampler_desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	sampler_desc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampler_desc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampler_desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampler_desc.MaxAnisotropy = 1;
+	sampler_desc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+	sampler_desc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	if (FAILED(device->CreateSamplerState(&sampler_desc, &sample_state_)))
+		return false;
+
+	return true;
+}
+
+bool SpriteBatch::InitializeBuffers(ID3D11Device* device)
+{
+	// Setup a dynamic vertex buffer that is refilled with every batch.
+	D3D11_BUFFER_DESC vertex_buffer_desc;
+	vertex_buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+	vertex_buffer_desc.ByteWidth = sizeof(SpriteVertex) * 4 * SPRITE_BATCH_SIZE;
+	vertex_buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertex_buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	vertex_buffer_desc.MiscFlags = 0;
+	vertex_buffer_desc.StructureByteStride = 0;
+
+	if (FAILED(device->CreateBuffer(&vertex_buffer_desc, 0, &vertex_buffer_)))
+		return false;
+
+	// Every quad uses the same two clockwise triangles, so the index buffer never changes.
+	std::vector<unsigned short> indices(6 * SPRITE_BATCH_SIZE);
+	for (unsigned int sprite = 0; sprite < SPRITE_BATCH_SIZE; sprite++)
+	{
+		unsigned short first = static_cast<unsigned short>(sprite * 4);
+		unsigned short quad[6] = { first, static_cast<unsigned short>(first + 1), static_cast<unsigned short>(first + 2),
+			first, static_cast<unsigned short>(first + 2), static_cast<unsigned short>(first + 3) };
+		std::copy(quad, quad + 6, &indices[sprite * 6]);
+	}
+
+	D3D11_BUFFER_DESC index_buffer_desc;
+	index_buffer_desc.Usage = D3D11_USAGE_IMMUTABLE;
+	index_buffer_desc.ByteWidth = static_cast<unsigned int>(sizeof(unsigned short) * indices.size());
+	index_buffer_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	index_buffer_desc.CPUAccessFlags = 0;
+	index_buffer_desc.MiscFlags = 0;
+	index_buffer_desc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA index_data;
+	index_data.pSysMem = indices.data();
+	index_data.SysMemPitch = 0;
+	index_data.SysMemSlicePitch = 0;
+
+	if (FAILED(device->CreateBuffer(&index_buffer_desc, &index_data, &index_buffer_)))
+		return false;
+
+	// Create a single white texel for solid colour sprites.
+	D3D11_TEXTURE2D_DESC texture_desc;
+	ZeroMemory(&texture_desc, sizeof(texture_desc));
+	texture_desc.Width = 1;
+	texture_desc.Height = 1;
+	texture_desc.MipLevels = 1;
+	texture_desc.ArraySize = 1;
+	texture_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	texture_desc.SampleDesc.Count = 1;
+	texture_desc.Usage = D3D11_USAGE_IMMUTABLE;
+	texture_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	unsigned int white = 0xffffffff;
+	D3D11_SUBRESOURCE_DATA texture_data;
+	texture_data.pSysMem = &white;
+	texture_data.SysMemPitch = sizeof(white);
+	texture_data.SysMemSlicePitch = 0;
+
+	if (FAILED(device->CreateTexture2D(&texture_desc, &texture_data, &white_texture_)))
+		return false;
+
+	if (FAILED(device->CreateShaderResourceView(white_texture_, 0, &white_texture_view_)))
+		return false;
+
+	return true;
+}
+
+unsigned int SpriteBatch::FindTextureSlot(ID3D11ShaderResourceView* texture)
+{
+	// Slots are handed out in order of first use; batches rarely see more than a handful of textures.
+	for (size_t slot = textures_.size(); slot > 0; slot--)
+	{
+		if (textures_[slot - 1] == texture)
+			return static_cast<unsigned int>(slot - 1);
+	}
+
+	textures_.push_back(texture);
+	return static_cast<unsigned int>(textures_.size() - 1);
+}
+
+bool SpriteBatch::RenderSprites(Direct3D* direct3D)
+{
+	ID3D11DeviceContext* device_context = direct3D->GetDeviceContext();
+
+	// Map pixels (origin top left, y down) into the orthographic projection (origin at the centre, y up). Depth is set
+	// inside the projection's near and far planes; with the Z buffer off its value does not matter otherwise.
+	XMMATRIX ortho;
+	direct3D->GetOrthoMatrix(ortho);
+	XMMATRIX screen = XMMatrixMultiply(XMMatrixScaling(1.0f, -1.0f, 1.0f), XMMatrixTranslation(-0.5f * screen_width_, 0.5f * screen_height_, 1.0f));
+	XMFLOAT4X4 screen_to_clip;
+	XMStoreFloat4x4(&screen_to_clip, XMMatrixTranspose(XMMatrixMultiply(screen, ortho)));
+	if (!direct3D->UpdateConstantBuffer(matrix_buffer_, &screen_to_clip, sizeof(screen_to_clip)))
+		return false;
+
+	// Bind the pipeline once for the whole batch.
+	unsigned int stride = sizeof(SpriteVertex);
+	unsigned int offset = 0;
+	device_context->IASetVertexBuffers(0, 1, &vertex_buffer_, &stride, &offset);
+	device_context->IASetIndexBuffer(index_buffer_, DXGI_FORMAT_R16_UINT, 0);
+	device_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	device_context->IASetInputLayout(layout_);
+	device_context->VSSetShader(vertex_shader_, 0, 0);
+	device_context->VSSetConstantBuffers(0, 1, &matrix_buffer_);
+	device_context->PSSetShader(pixel_shader_, 0, 0);
+	device_context->PSSetSamplers(0, 1, &sample_state_);
+
+	unsigned int sprite_count = static_cast<unsigned int>(sort_keys_.size());
+	for (unsigned int first = 0; first < sprite_count; first += SPRITE_BATCH_SIZE)
+	{
+		unsigned int count = (std::min)(SPRITE_BATCH_SIZE, sprite_count - first);
+
+		// Write the quads in sorted order.
+		D3D11_MAPPED_SUBRESOURCE mapped_resource;
+		if (FAILED(device_context->Map(vertex_buffer_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped_resource)))
+			return false;
+
+		SpriteVertex* vertices = static_cast<SpriteVertex*>(mapped_resource.pData);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const Sprite& sprite = sprites_[static_cast<unsigned int>(sort_keys_[first + i])];
+			float left = sprite.destination.x, top = sprite.destination.y;
+			float right = left + sprite.destination.z, bottom = top + sprite.destination.w;
+
+			SpriteVertex* quad = vertices + i * 4;
+			quad[0].position = XMFLOAT2(left, top);
+			quad[0].texture = XMFLOAT2(sprite.uv.x, sprite.uv.y);
+			quad[1].position = XMFLOAT2(right, top);
+			quad[1].texture = XMFLOAT2(sprite.uv.z, sprite.uv.y);
+			quad[2].position = XMFLOAT2(right, bottom);
+			quad[2].texture = XMFLOAT2(sprite.uv.z, sprite.uv.w);
+			quad[3].position = XMFLOAT2(left, bottom);
+			quad[3].texture = XMFLOAT2(sprite.uv.x, sprite.uv.w);
+			quad[0].colour = quad[1].colour = quad[2].colour = quad[3].colour = sprite.colour;
+		}
+
+		device_context->Unmap(vertex_buffer_, 0);
+
+		// One draw per run of sprites sharing a texture. Runs carry on across layers when the texture does not change.
+		unsigned int run_start = 0;
+		while (run_start < count)
+		{
+			ID3D11ShaderResourceView* texture = sprites_[static_cast<unsigned int>(sort_keys_[first + run_start])].texture;
+			unsigned int run_end = run_start + 1;
+			while (run_end < count && sprites_[static_cast<unsigned int>(sort_keys_[first + run_end])].texture == texture)
+				run_end++;
+
+			device_context->PSSetShaderResources(0, 1, &texture);
+			device_context->DrawIndexed((run_end - run_start) * 6, run_start * 6, 0);
+			draw_count_++;
+
+			run_start = run_end;
+		}
+	}
+
+	return true;
+}
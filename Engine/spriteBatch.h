@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <d3d11.h>
+#include <DirectXMath.h>
+using namespace DirectX;
+
+class Direct3D;
+class Font;
+
+// Sprites written to the vertex buffer per fill. Larger batches are drawn in several fills; 16 bit indices cap it at 16384.
+const unsigned int SPRITE_BATCH_SIZE = 4096;
+
+class SpriteBatch
+{
+public:
+	SpriteBatch();
+	SpriteBatch(const SpriteBatch&);
+	~SpriteBatch();
+
+	// Create the buffers and shaders for drawing onto a screen of the given size.
+	bool Initialize(Direct3D*, int, int);
+	void Shutdown();
+
+	// Collect sprites between Begin and End. Rectangles are (left, top, width, height) in pixels from the top left of the
+	// screen and texture coordinates are (left, top, right, bottom). A null texture draws a solid colour.
+	// Lower layers are drawn first. Within a layer, sprites are grouped by texture, so draw order is only kept between
+	// sprites sharing a texture.
+	void Begin();
+	void Draw(ID3D11ShaderResourceView*, const XMFLOAT4&, const XMFLOAT4&, const XMFLOAT4&, int);
+	void DrawString(Font*, const wchar_t*, float, float, const XMFLOAT4&, int);
+	bool End(Direct3D*);
+
+	// Order the collected sprites by layer, then texture, then submission. End does this itself; it is public so the
+	// sort can be measured on its own.
+	void Sort();
+
+	// Draw calls issued by the last End.
+	unsigned int GetDrawCount();
+
+private:
+	struct SpriteVertex
+	{
+		XMFLOAT2 position;
+		XMFLOAT2 texture;
+		unsigned int colour;
+	};
+
+	struct Sprite
+	{
+		XMFLOAT4 destination;
+		XMFLOAT4 uv;
+		unsigned int colour;
+		ID3D11ShaderResourceView* texture;
+	};
+
+	bool InitializeShaders(ID3D11Device*);
+	bool InitializeBuffers(ID3D11Device*);
+	unsigned int FindTextureSlot(ID3D11ShaderResourceView*);
+	bool RenderSprites(Direct3D*);
+
+private:
+	int screen_width_;
+	int screen_height_;
+	ID3D11VertexShader* vertex_shader_;
+	ID3D11PixelShader* pixel_shader_;
+	ID3D11InputLayout* layout_;
+	ID3D11SamplerState* sample_state_;
+	ID3D11Buffer* vertex_buffer_;
+	ID3D11Buffer* index_buffer_;
+	ID3D11Buffer* matrix_buffer_;
+	ID3D11Texture2D* white_texture_;
+	ID3D11ShaderResourceView* white_texture_view_;
+	std::vector<Sprite> sprites_;
+	std::vector<unsigned long long> sort_keys_;
+	std::vector<ID3D11ShaderResourceView*> textures_;
+	unsigned int draw_count_;
+};
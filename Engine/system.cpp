@@ -1,8 +1,19 @@
 #include "system.h"
 
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
 System::System() :
+	window_(0),
 	input_(0),
-	graphics_(0)
+	graphics_(0),
+	job_system_(0),
+	owns_job_system_(false),
+	scheduler_(0),
+	broadphase_(0),
+	replay_(0),
+	headless_frame_count_(HEADLESS_FRAME_COUNT)
 {
 }
 
@@ -14,12 +25,58 @@ System::~System()
 {
 }
 
-bool System::Initialize()
+bool System::Initialize(const char* command_line, JobSystem* job_system)
 {
 	int screen_width = 0, screen_height = 0;
 
-	// Initialize the Windows API.
-	InitializeWindows(screen_width, screen_height);
+	// Create the Replay object.
+	// The Replay object records the input and frame times of a session, or plays a recording back without a window.
+	replay_ = new Replay();
+	if (!replay_)
+		return false;
+
+	// Read the record and replay options from the command line.
+	std::string record_path, replay_path;
+	bool headless = false;
+	ParseCommandLine(command_line, record_path, replay_path, headless);
+
+	// A session is either recorded or played back, never both.
+	if (!record_path.empty() && !replay_path.empty())
+		return false;
+
+	if (!replay_path.empty())
+	{
+		// Load the recording and seed the session exactly as it was recorded.
+		if (!replay_->BeginPlayback(replay_path.c_str()))
+			return false;
+
+		srand(replay_->GetSeed());
+		headless = true;
+	}
+
+	if (headless)
+	{
+		// Headless sessions have no window and render to a null device at the windowed resolution.
+		screen_width = WINDOWED_SCREEN_WIDTH;
+		screen_height = WINDOWED_SCREEN_HEIGHT;
+		window_ = 0;
+	}
+	else
+	{
+		// Initialize the Windows API.
+		InitializeWindows(screen_width, screen_height);
+	}
+
+	// Start recording if requested, with a fresh seed stored alongside the input. Headless sessions record their frame
+	// times only, as they receive no input.
+	if (!record_path.empty())
+	{
+		unsigned int seed = GetTickCount();
+		if (!replay_->BeginRecording(record_path.c_str(), seed))
+			return false;
+
+		srand(seed);
+	}
 
 	// Create the Input object.
 	// The Input object will be used to handle input from the user.
@@ -30,6 +87,52 @@ bool System::Initialize()
 	// Initialize the Input object.
 	input_->Initialize();
 
+	// Use the caller's JobSystem object when there is one, so a host such as the benchmark harness does not end up with
+	// two sets of worker threads.
+	if (job_system)
+	{
+		job_system_ = job_system;
+		owns_job_system_ = false;
+	}
+	else
+	{
+		// Create the JobSystem object.
+		// The JobSystem object spreads per-frame work such as animation across the worker threads.
+		job_system_ = new JobSystem();
+		if (!job_system_)
+			return false;
+
+		owns_job_system_ = true;
+
+		// Initialize the JobSystem object with a worker per spare hardware thread.
+		if (!job_system_->Initialize(0))
+			return false;
+	}
+
+	// Create the TaskScheduler object.
+	// The TaskScheduler object resumes coroutine tasks on the main, render and worker threads as their awaits complete.
+	scheduler_ = new TaskScheduler();
+	if (!scheduler_)
+		return false;
+
+	// Initialize the TaskScheduler object.
+	if (!scheduler_->Initialize(job_system_))
+		return false;
+
+	// Create the Broadphase object.
+	// The Broadphase object finds the overlapping pairs of bounding boxes for gameplay and physics.
+	broadphase_ = new Broadphase();
+	if (!broadphase_)
+		return false;
+
+	// Initialize the Broadphase object.
+	if (!broadphase_->Initialize(job_system_))
+		return false;
+
+	// Start the frame timer.
+	QueryPerformanceFrequency(&timer_frequency_);
+	QueryPerformanceCounter(&last_frame_time_);
+
 	// Create the Graphics object.
 	// The Graphics object will handle rendering all graphics for the application.
 	graphics_ = new Graphics();
@@ -37,11 +140,20 @@ bool System::Initialize()
 		return false;
 
 	// Initialize the Graphics object and return its result.
-	return graphics_->Initialize(screen_width, screen_height, window_);
+	return graphics_->Initialize(screen_width, screen_height, window_, job_system_);
 }
 
 void System::Shutdown()
 {
+	// Shutdown and release the TaskScheduler object first, so no task is resumed while the objects it uses are released.
+	// It waits for the tasks running on workers, so the JobSystem must still be up.
+	if (scheduler_)
+	{
+		scheduler_->Shutdown();
+		delete scheduler_;
+		scheduler_ = 0;
+	}
+
 	// Shutdown and Release the Graphics object.
 	if (graphics_)
 	{
@@ -50,6 +162,36 @@ void System::Shutdown()
 		graphics_ = 0;
 	}
 
+	// Shutdown and release the Broadphase object.
+	if (broadphase_)
+	{
+		broadphase_->Shutdown();
+		delete broadphase_;
+		broadphase_ = 0;
+	}
+
+	// Shutdown and release the JobSystem object, unless it belongs to the caller.
+	if (job_system_)
+	{
+		if (owns_job_system_)
+		{
+			job_system_->Shutdown();
+			delete job_system_;
+		}
+		job_system_ = 0;
+	}
+
+	// Write the replay timings and any recording, then release the Replay object.
+	if (replay_)
+	{
+		if (replay_->IsPlaying() && !timings_path_.empty())
+			replay_->WriteTimings(timings_path_.c_str());
+
+		replay_->Shutdown();
+		delete replay_;
+		replay_ = 0;
+	}
+
 	// Release the Input object.
 	if (input_)
 	{
@@ -57,12 +199,31 @@ void System::Shutdown()
 		input_ = 0;
 	}
 
-	// Shutdown the Windows API.
-	ShutdownWindows();
+	// Shutdown the Windows API (headless replays never created a window).
+	if (window_)
+		ShutdownWindows();
 }
 
 void System::Run()
 {
+	// Recordings are played back without a window, as fast as the engine can process the frames.
+	if (replay_->IsPlaying())
+	{
+		RunReplay();
+		return;
+	}
+
+	// Other headless sessions have no window to quit from, so they run a fixed number of frames.
+	if (!window_)
+	{
+		for (unsigned int frame = 0; frame < headless_frame_count_; frame++)
+		{
+			if (!Frame(replay_->RecordFrame(MeasureFrameTime())))
+				break;
+		}
+		return;
+	}
+
 	// Initialize the message structure.
 	MSG message;
 	ZeroMemory(&message, sizeof(MSG));
@@ -85,8 +246,11 @@ void System::Run()
 		}
 		else
 		{
+			// Measure the frame time. When recording it is stored and handed back as playback will see it.
+			float frame_time = replay_->RecordFrame(MeasureFrameTime());
+
 			// Do any frame processing.
-			result = Frame();
+			result = Frame(frame_time);
 
 			// If there were any issues during Frame processing we will tell the application to quit.
 			if (!result)
@@ -95,28 +259,109 @@ void System::Run()
 	}
 }
 
-bool System::Frame()
+void System::RunReplay()
+{
+	std::vector<ReplayEvent> events;
+	float frame_time = 0.0f;
+	LARGE_INTEGER frame_start, frame_end;
+
+	// Play the recorded frames back to back until the recording runs out or a frame asks to quit.
+	while (replay_->ReadFrame(events, frame_time))
+	{
+		// Deliver the recorded input through the same handler as live window messages.
+		for (const ReplayEvent& event : events)
+			MessageHandler(window_, event.message, event.key, 0);
+
+		// Process the frame with the recorded frame time and measure what it cost.
+		QueryPerformanceCounter(&frame_start);
+		bool result = Frame(frame_time);
+		QueryPerformanceCounter(&frame_end);
+
+		replay_->AddFrameTiming(static_cast<double>(frame_end.QuadPart - frame_start.QuadPart) * 1000.0 / static_cast<double>(timer_frequency_.QuadPart));
+
+		if (!result)
+			break;
+	}
+}
+
+bool System::Frame(float frame_time)
 {
 	// Check if the user pressed the escape key and wants to exit the application.
 	if (input_->IsKeyDown(VK_ESCAPE))
 		return false;
 
+	// Resume the main thread tasks whose frame, timer or other awaits have completed.
+	scheduler_->RunMain(frame_time);
+
+	// Rebuild the overlapping pairs of collision proxies.
+	broadphase_->Frame();
+
+	// Resume the render thread tasks before the frame is drawn.
+	scheduler_->RunRender();
+
 	// Do Graphics frame processing.
-	bool result = graphics_->Frame();
+	bool result = graphics_->Frame(frame_time);
 
 	return result;
 }
 
+float System::MeasureFrameTime()
+{
+	// Measure the time elapsed since the previous frame in seconds.
+	LARGE_INTEGER current_time;
+	QueryPerformanceCounter(&current_time);
+	float frame_time = static_cast<float>(current_time.QuadPart - last_frame_time_.QuadPart) / static_cast<float>(timer_frequency_.QuadPart);
+	last_frame_time_ = current_time;
+
+	return frame_time;
+}
+
+void System::ParseCommandLine(const char* command_line, std::string& record_path, std::string& replay_path, bool& headless)
+{
+	if (!command_line)
+		return;
+
+	// Read the options one at a time, allowing quoted paths.
+	std::istringstream stream(command_line);
+	std::string option, value;
+	while (stream >> option)
+	{
+		if (option == "-headless")
+		{
+			headless = true;
+			continue;
+		}
+
+		if (!(stream >> std::quoted(value)))
+			break;
+
+		if (option == "-record")
+			record_path = value;
+		else if (option == "-replay")
+			replay_path = value;
+		else if (option == "-timings")
+			timings_path_ = value;
+		else if (option == "-frames")
+			headless_frame_count_ = static_cast<unsigned int>(strtoul(value.c_str(), 0, 10));
+	}
+}
+
 LRESULT CALLBACK System::MessageHandler(HWND window, UINT message, WPARAM wparam, LPARAM lparam)
 {
 	switch (message)
 	{
 	// Check for a keyboard key press.
 	case WM_KEYDOWN:
+		// Capture the key press when recording a session.
+		replay_->RecordMessage(message, static_cast<UINT>(wparam));
+
 		// If a key is pressed - Send it to the Input object so it can record that state.
 		input_->KeyDown(static_cast<UINT>(wparam));
 		return 0;
 	case WM_KEYUP:
+		// Capture the key release when recording a session.
+		replay_->RecordMessage(message, static_cast<UINT>(wparam));
+
 		// If a key is released - Send it to the Input object so it can unset the state of the key.
 		input_->KeyUp(static_cast<UINT>(wparam));
 		return 0;
@@ -183,8 +428,8 @@ void System::InitializeWindows(int& screen_width, int& screen_height)
 	else
 	{
 		// If in windowed mode - set the default resolution.
-		screen_width = 800;
-		screen_height = 600;
+		screen_width = WINDOWED_SCREEN_WIDTH;
+		screen_height = WINDOWED_SCREEN_HEIGHT;
 
 		// Place the window in the centre of the screen.
 		position_x = (GetSystemMetrics(SM_CXSCREEN) - screen_width) / 2;
@@ -2,9 +2,21 @@
 #define WIN32_LEAN_AND_MEAN
 
 #include <Windows.h>
+#include <string>
 
 #include "input.h"
 #include "graphics.h"
+#include "jobSystem.h"
+#include "broadphase.h"
+#include "replay.h"
+#include "task.h"
+
+// Resolution used in windowed mode and for headless replays.
+const int WINDOWED_SCREEN_WIDTH = 800;
+const int WINDOWED_SCREEN_HEIGHT = 600;
+
+// Frames run by a headless session that is not playing a recording back (there is no window to quit from).
+const unsigned int HEADLESS_FRAME_COUNT = 600;
 
 class System
 {
@@ -13,15 +25,23 @@ public:
 	System(const System&);
 	~System();
 
-	bool Initialize();
+	// Command line options: -record <file>, -replay <file>, -timings <file> (per-frame cost of a replay), -headless
+	// (no window, null device) and -frames <count> (frames a headless session runs when not replaying).
+	// Engine jobs run on the given JobSystem, which the caller keeps ownership of, or on a new one when it is null.
+	bool Initialize(const char*, JobSystem*);
 	void Shutdown();
 	void Run();
 
+	// Process a single frame with the given frame time (seconds). Public so headless harnesses can drive the loop.
+	bool Frame(float);
+
 	// Message handler to handle incoming windows system messages.
 	LRESULT CALLBACK MessageHandler(HWND, UINT, WPARAM, LPARAM);
 
 private:
-	bool Frame();
+	float MeasureFrameTime();
+	void RunReplay();
+	void ParseCommandLine(const char*, std::string&, std::string&, bool&);
 	void InitializeWindows(int&, int&);
 	void ShutdownWindows();
 
@@ -32,6 +52,16 @@ private:
 
 	Input* input_;
 	Graphics* graphics_;
+	JobSystem* job_system_;
+	bool owns_job_system_;
+	TaskScheduler* scheduler_;
+	Broadphase* broadphase_;
+	Replay* replay_;
+	std::string timings_path_;
+	unsigned int headless_frame_count_;
+
+	LARGE_INTEGER timer_frequency_;
+	LARGE_INTEGER last_frame_time_;
 };
 
 static LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
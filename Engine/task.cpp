@@ -0,0 +1,397 @@
+#include "task.h"
+
+#include <fstream>
+#include "jobSystem.h"
+#include "poolAllocator.h"
+
+// The thread the calling code is running on, or -1 outside the scheduler.
+static thread_local int current_task_thread = -1;
+
+static PoolAllocator& TaskFrameAllocator()
+{
+	// Created on first use and kept for the life of the process, as frames can be freed until the last task is gone.
+	static PoolAllocator* allocator = new PoolAllocator();
+	return *allocator;
+}
+
+void* AllocateTaskFrame(size_t size)
+{
+	return TaskFrameAllocator().Allocate(size);
+}
+
+void FreeTaskFrame(void* memory, size_t size)
+{
+	TaskFrameAllocator().Free(memory, size);
+}
+
+// The coroutine a spawned task runs inside. It owns the task and hands itself back to the scheduler when it returns.
+struct SpawnedTask
+{
+	struct promise_type : TaskPromiseBase
+	{
+		TaskScheduler* scheduler;
+
+		struct FinalAwaiter
+		{
+			bool await_ready() noexcept { return false; }
+			void await_suspend(std::coroutine_handle<promise_type> handle) noexcept { handle.promise().scheduler->ReleaseTask(handle); }
+			void await_resume() noexcept {}
+		};
+
+		SpawnedTask get_return_object() { return SpawnedTask{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+		FinalAwaiter final_suspend() noexcept { return {}; }
+		void return_void() {}
+	};
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+static SpawnedTask RunSpawnedTask(Task<void> task)
+{
+	co_await task;
+}
+
+bool SwitchToAwaiter::await_ready()
+{
+	return scheduler->IsOnThread(thread);
+}
+
+void SwitchToAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+	scheduler->Schedule(handle, thread);
+}
+
+void NextFrameAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+	scheduler->ScheduleNextFrame(handle, thread);
+}
+
+void DelayAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+	scheduler->ScheduleAfter(handle, seconds, thread);
+}
+
+void LoadFileAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+	scheduler->ReadFile(this, handle);
+}
+
+TaskScheduler::TaskScheduler()
+{
+	job_system_ = 0;
+	frame_ = 0;
+	time_ = 0.0;
+	stopping_ = false;
+	worker_jobs_ = 0;
+}
+
+TaskScheduler::TaskScheduler(const TaskScheduler& kOther)
+{
+}
+
+TaskScheduler::~TaskScheduler()
+{
+}
+
+bool TaskScheduler::Initialize(JobSystem* job_system)
+{
+	if (!job_system)
+		return false;
+
+	job_system_ = job_system;
+	frame_ = 0;
+	time_ = 0.0;
+	stopping_ = false;
+	worker_jobs_ = 0;
+
+	// Start the file thread.
+	file_thread_ = std::thread(&TaskScheduler::FileLoop, this);
+	return true;
+}
+
+void TaskScheduler::Shutdown()
+{
+	// Stop resuming tasks and let the file thread finish the read it is on; reads still queued are dropped.
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+		file_reads_.clear();
+	}
+	file_condition_.notify_all();
+
+	if (file_thread_.joinable())
+		file_thread_.join();
+
+	// Wait for every worker job queued for the tasks. Jobs that had not started yet see the scheduler stopping and
+	// leave their task suspended.
+	// Destroying a spawned task destroys the tasks it is awaiting along with it, so the waits and queues only hold
+	// handles into frames that are already gone.
+	std::unordered_set<void*> tasks;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		idle_condition_.wait(lock, [this]() { return worker_jobs_ == 0; });
+
+		tasks.swap(tasks_);
+		main_queue_.clear();
+		render_queue_.clear();
+		frame_waits_.clear();
+		timer_waits_.clear();
+	}
+
+	for (void* task : tasks)
+		std::coroutine_handle<>::from_address(task).destroy();
+
+	running_.clear();
+	due_.clear();
+	job_system_ = 0;
+}
+
+void TaskScheduler::Spawn(Task<void> task, TaskThread thread)
+{
+	SpawnedTask spawned = RunSpawnedTask(std::move(task));
+	spawned.handle.promise().scheduler = this;
+
+	bool stopping;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping = stopping_;
+		if (!stopping)
+			tasks_.insert(spawned.handle.address());
+	}
+
+	// Shutdown only destroys the tasks it knows of, so one spawned once it has begun is destroyed here.
+	if (stopping)
+	{
+		spawned.handle.destroy();
+		return;
+	}
+
+	Schedule(spawned.handle, thread);
+}
+
+void TaskScheduler::RunMain(float frame_time)
+{
+	// Collect the waits that are due; frame waits added from here on are for the next frame.
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		frame_++;
+		time_ += frame_time;
+
+		due_.swap(frame_waits_);
+		for (size_t i = 0; i < timer_waits_.size();)
+		{
+			if (timer_waits_[i].time <= time_)
+			{
+				due_.push_back(timer_waits_[i]);
+				timer_waits_[i] = timer_waits_.back();
+				timer_waits_.pop_back();
+			}
+			else
+				i++;
+		}
+	}
+
+	for (TaskWait& wait : due_)
+		Schedule(wait.handle, wait.thread);
+	due_.clear();
+
+	RunQueue(main_queue_, TASK_THREAD_MAIN);
+}
+
+void TaskScheduler::RunRender()
+{
+	RunQueue(render_queue_, TASK_THREAD_RENDER);
+}
+
+SwitchToAwaiter TaskScheduler::SwitchTo(TaskThread thread)
+{
+	return SwitchToAwaiter{ this, thread };
+}
+
+NextFrameAwaiter TaskScheduler::NextFrame(TaskThread thread)
+{
+	return NextFrameAwaiter{ this, thread };
+}
+
+DelayAwaiter TaskScheduler::Delay(float seconds, TaskThread thread)
+{
+	return DelayAwaiter{ this, thread, seconds };
+}
+
+LoadFileAwaiter TaskScheduler::LoadFile(const char* path, std::vector<unsigned char>& bytes, TaskThread thread)
+{
+	return LoadFileAwaiter{ this, thread, path, &bytes, false };
+}
+
+unsigned int TaskScheduler::GetTaskCount()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return static_cast<unsigned int>(tasks_.size());
+}
+
+unsigned long long TaskScheduler::GetFrame()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return frame_;
+}
+
+double TaskScheduler::GetTime()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return time_;
+}
+
+bool TaskScheduler::IsOnThread(TaskThread thread)
+{
+	return current_task_thread == thread;
+}
+
+void TaskScheduler::Schedule(std::coroutine_handle<> handle, TaskThread thread)
+{
+	// The handle may be resumed as soon as it is queued, so nothing here touches the coroutine afterwards. Once the
+	// scheduler is stopping the task stays suspended until Shutdown destroys it.
+	if (thread == TASK_THREAD_WORKER)
+	{
+		if (!BeginWorkerJob())
+			return;
+
+		job_system_->Execute([this, handle]()
+		{
+			if (!IsStopping())
+			{
+				current_task_thread = TASK_THREAD_WORKER;
+				handle.resume();
+			}
+			EndWorkerJob();
+		});
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (stopping_)
+		return;
+
+	if (thread == TASK_THREAD_RENDER)
+		render_queue_.push_back(handle);
+	else
+		main_queue_.push_back(handle);
+}
+
+void TaskScheduler::ScheduleNextFrame(std::coroutine_handle<> handle, TaskThread thread)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	TaskWait wait = { handle, thread, 0.0 };
+	frame_waits_.push_back(wait);
+}
+
+void TaskScheduler::ScheduleAfter(std::coroutine_handle<> handle, float seconds, TaskThread thread)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	TaskWait wait = { handle, thread, time_ + seconds };
+	timer_waits_.push_back(wait);
+}
+
+void TaskScheduler::ReadFile(LoadFileAwaiter* awaiter, std::coroutine_handle<> handle)
+{
+	// The awaiter lives in the suspended coroutine's frame, so it stays valid until the coroutine is resumed or, once
+	// the scheduler is stopping, destroyed by Shutdown after the file thread has exited.
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (stopping_)
+			return;
+
+		FileRead read = { awaiter, handle };
+		file_reads_.push_back(read);
+	}
+	file_condition_.notify_one();
+}
+
+void TaskScheduler::ReleaseTask(std::coroutine_handle<> handle)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		tasks_.erase(handle.address());
+	}
+
+	handle.destroy();
+}
+
+bool TaskScheduler::BeginWorkerJob()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (stopping_)
+		return false;
+
+	worker_jobs_++;
+	return true;
+}
+
+void TaskScheduler::EndWorkerJob()
+{
+	// Notified under the lock, so Shutdown cannot return and the scheduler be deleted before this is done with it.
+	std::lock_guard<std::mutex> lock(mutex_);
+	worker_jobs_--;
+	if (worker_jobs_ == 0)
+		idle_condition_.notify_all();
+}
+
+bool TaskScheduler::IsStopping()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stopping_;
+}
+
+void TaskScheduler::FileLoop()
+{
+	for (;;)
+	{
+		// Wait for a read, or exit once the scheduler is stopping.
+		FileRead read;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			file_condition_.wait(lock, [this]() { return stopping_ || !file_reads_.empty(); });
+			if (stopping_)
+				return;
+
+			read = file_reads_.front();
+			file_reads_.pop_front();
+		}
+
+		LoadFileAwaiter* awaiter = read.awaiter;
+		std::vector<unsigned char>& bytes = *awaiter->bytes;
+		bytes.clear();
+
+		std::ifstream file(awaiter->path, std::ios::binary | std::ios::ate);
+		std::streamoff size = file ? static_cast<std::streamoff>(file.tellg()) : -1;
+		if (size >= 0)
+		{
+			bytes.resize(static_cast<size_t>(size));
+			file.seekg(0);
+			awaiter->loaded = size == 0 || file.read(reinterpret_cast<char*>(bytes.data()), size).good();
+		}
+
+		if (!awaiter->loaded)
+			bytes.clear();
+
+		// Hand the task back; a worker resume is queued on the job system.
+		Schedule(read.handle, awaiter->thread);
+	}
+}
+
+void TaskScheduler::RunQueue(std::vector<std::coroutine_handle<>>& queue, TaskThread thread)
+{
+	// Run the tasks queued so far. Tasks queued while these run wait for the next pump.
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_.swap(queue);
+	}
+
+	int previous_thread = current_task_thread;
+	current_task_thread = thread;
+
+	for (std::coroutine_handle<> handle : running_)
+		handle.resume();
+	running_.clear();
+
+	current_task_thread = previous_thread;
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+class JobSystem;
+class TaskScheduler;
+
+// Threads a task can be resumed on. There is no separate render thread: main and render tasks both run on the main
+// thread, main tasks at the start of System::Frame and render tasks just before Graphics::Frame, when the device context
+// is free. Worker tasks run on the job system.
+enum TaskThread
+{
+	TASK_THREAD_MAIN = 0,
+	TASK_THREAD_RENDER = 1,
+	TASK_THREAD_WORKER = 2
+};
+
+// Every coroutine frame is allocated from one pool shared by all tasks, rather than from the global heap.
+void* AllocateTaskFrame(size_t);
+void FreeTaskFrame(void*, size_t);
+
+// Resumes whoever awaited a task once it returns, without growing the stack.
+struct TaskFinalAwaiter
+{
+	bool await_ready() noexcept { return false; }
+	void await_resume() noexcept {}
+
+	template <typename Promise>
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+	{
+		std::coroutine_handle<> continuation = handle.promise().continuation;
+		return continuation ? continuation : std::noop_coroutine();
+	}
+};
+
+// Promise parts shared by every task. Tasks start suspended and only run once awaited or spawned.
+struct TaskPromiseBase
+{
+	std::coroutine_handle<> continuation;
+
+	static void* operator new(size_t size) { return AllocateTaskFrame(size); }
+	static void operator delete(void* memory, size_t size) { FreeTaskFrame(memory, size); }
+
+	std::suspend_always initial_suspend() noexcept { return {}; }
+	TaskFinalAwaiter final_suspend() noexcept { return {}; }
+
+	// The engine does not use exceptions; one escaping a task is a bug.
+	void unhandled_exception() { std::abort(); }
+};
+
+template <typename T>
+class Task;
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase
+{
+	T result;
+
+	Task<T> get_return_object();
+	void return_value(T value) { result = std::move(value); }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase
+{
+	Task<void> get_return_object();
+	void return_void() {}
+};
+
+// A coroutine returning T. Awaiting a task runs it and resumes the awaiting coroutine when it returns, on whichever
+// thread it finished on. Destroying a task destroys its frame, so a task must outlive any await of it.
+template <typename T = void>
+class Task
+{
+public:
+	typedef TaskPromise<T> promise_type;
+
+	Task() : handle_(nullptr) {}
+	explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+	Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+	Task(const Task&) = delete;
+	~Task() { if (handle_) handle_.destroy(); }
+
+	Task& operator=(Task&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (handle_)
+				handle_.destroy();
+			handle_ = std::exchange(other.handle_, nullptr);
+		}
+		return *this;
+	}
+
+	Task& operator=(const Task&) = delete;
+
+	bool IsDone() const { return !handle_ || handle_.done(); }
+
+	bool await_ready() const { return IsDone(); }
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting)
+	{
+		handle_.promise().continuation = awaiting;
+		return handle_;
+	}
+
+	T await_resume()
+	{
+		if constexpr (!std::is_void<T>::value)
+			return std::move(handle_.promise().result);
+	}
+
+private:
+	std::coroutine_handle<promise_type> handle_;
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object()
+{
+	return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object()
+{
+	return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// Resume on another thread: co_await scheduler->SwitchTo(TASK_THREAD_WORKER).
+struct SwitchToAwaiter
+{
+	TaskScheduler* scheduler;
+	TaskThread thread;
+
+	bool await_ready();
+	void await_suspend(std::coroutine_handle<>);
+	void await_resume() {}
+};
+
+// Resume on a thread at the start of the next frame.
+struct NextFrameAwaiter
+{
+	TaskScheduler* scheduler;
+	TaskThread thread;
+
+	bool await_ready() { return false; }
+	void await_suspend(std::coroutine_handle<>);
+	void await_resume() {}
+};
+
+// Resume on a thread once the given number of seconds of frame time have passed.
+struct DelayAwaiter
+{
+	TaskScheduler* scheduler;
+	TaskThread thread;
+	float seconds;
+
+	bool await_ready() { return false; }
+	void await_suspend(std::coroutine_handle<>);
+	void await_resume() {}
+};
+
+// Read a whole file on the scheduler's file thread, then resume on a thread. Evaluates to whether the file was read.
+struct LoadFileAwaiter
+{
+	TaskScheduler* scheduler;
+	TaskThread thread;
+	const char* path;
+	std::vector<unsigned char>* bytes;
+	bool loaded;
+
+	bool await_ready() { return false; }
+	void await_suspend(std::coroutine_handle<>);
+	bool await_resume() { return loaded; }
+};
+
+class TaskScheduler
+{
+public:
+	TaskScheduler();
+	TaskScheduler(const TaskScheduler&);
+	~TaskScheduler();
+
+	bool Initialize(JobSystem*);
+
+	// Stop resuming tasks, finish the file read in progress and drop the rest, wait for any worker job still running a
+	// task, then destroy every task still waiting. Call before releasing anything the tasks use; the job system must
+	// still be running.
+	void Shutdown();
+
+	// Start a task on a thread. The scheduler owns it until it returns; a task spawned while stopping is destroyed.
+	void Spawn(Task<void>, TaskThread);
+
+	// Advance the clock by the frame time, wake the frame and timer waits that are due, then resume the main thread
+	// tasks. Called once at the start of every frame.
+	void RunMain(float);
+
+	// Resume the render tasks on the calling (main) thread. Called each frame at the point the device context is free.
+	void RunRender();
+
+	// The awaitables, for use inside tasks. The path given to LoadFile must stay valid until the await completes.
+	SwitchToAwaiter SwitchTo(TaskThread);
+	NextFrameAwaiter NextFrame(TaskThread);
+	DelayAwaiter Delay(float, TaskThread);
+	LoadFileAwaiter LoadFile(const char*, std::vector<unsigned char>&, TaskThread);
+
+	// Spawned tasks that have not yet returned.
+	unsigned int GetTaskCount();
+	unsigned long long GetFrame();
+	double GetTime();
+
+	// Used by the awaitables and spawned tasks.
+	bool IsOnThread(TaskThread);
+	void Schedule(std::coroutine_handle<>, TaskThread);
+	void ScheduleNextFrame(std::coroutine_handle<>, TaskThread);
+	void ScheduleAfter(std::coroutine_handle<>, float, TaskThread);
+	void ReadFile(LoadFileAwaiter*, std::coroutine_handle<>);
+	void ReleaseTask(std::coroutine_handle<>);
+
+private:
+	struct TaskWait
+	{
+		std::coroutine_handle<> handle;
+		TaskThread thread;
+		double time;
+	};
+
+	struct FileRead
+	{
+		LoadFileAwaiter* awaiter;
+		std::coroutine_handle<> handle;
+	};
+
+	void RunQueue(std::vector<std::coroutine_handle<>>&, TaskThread);
+	void FileLoop();
+	bool BeginWorkerJob();
+	void EndWorkerJob();
+	bool IsStopping();
+
+private:
+	JobSystem* job_system_;
+	std::mutex mutex_;
+	std::condition_variable idle_condition_;
+	std::condition_variable file_condition_;
+	unsigned long long frame_;
+	double time_;
+
+	// Set by Shutdown; from then on nothing is resumed. Worker jobs queued for tasks are counted so Shutdown can wait
+	// for them.
+	bool stopping_;
+	unsigned int worker_jobs_;
+
+	std::vector<std::coroutine_handle<>> main_queue_;
+	std::vector<std::coroutine_handle<>> render_queue_;
+	std::vector<std::coroutine_handle<>> running_;
+	std::vector<TaskWait> frame_waits_;
+	std::vector<TaskWait> timer_waits_;
+	std::vector<TaskWait> due_;
+	std::unordered_set<void*> tasks_;
+
+	// File reads block, so they run one at a time on a thread of their own rather than holding up a worker. Only the
+	// resume goes through the job system.
+	std::thread file_thread_;
+	std::deque<FileRead> file_reads_;
+};
@@ -0,0 +1,199 @@
+#include "textureAtlas.h"
+
+#include <algorithm>
+#include "direct3D.h"
+
+TextureAtlas::TextureAtlas() :
+	width_(0),
+	height_(0),
+	texture_(0),
+	texture_view_(0)
+{
+}
+
+TextureAtlas::TextureAtlas(const TextureAtlas& kOther)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+}
+
+bool TextureAtlas::Initialize(Direct3D* direct3D, unsigned int width, unsigned int height)
+{
+	width_ = width;
+	height_ = height;
+
+	// Start with a single empty run along the top of the texture.
+	SkylineNode node = { 0, 0, width };
+	skyline_.assign(1, node);
+
+	// Setup the description of the atlas texture. It is written a region at a time as images are added.
+	D3D11_TEXTURE2D_DESC texture_desc;
+	ZeroMemory(&texture_desc, sizeof(texture_desc));
+	texture_desc.Width = width;
+	texture_desc.Height = height;
+	texture_desc.MipLevels = 1;
+	texture_desc.ArraySize = 1;
+	texture_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	texture_desc.SampleDesc.Count = 1;
+	texture_desc.SampleDesc.Quality = 0;
+	texture_desc.Usage = D3D11_USAGE_DEFAULT;
+	texture_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	texture_desc.CPUAccessFlags = 0;
+	texture_desc.MiscFlags = 0;
+
+	// Clear it to transparent so the padding between images samples as nothing.
+	std::vector<unsigned int> clear(width * height, 0);
+	D3D11_SUBRESOURCE_DATA initial_data;
+	initial_data.pSysMem = clear.data();
+	initial_data.SysMemPitch = width * 4;
+	initial_data.SysMemSlicePitch = 0;
+
+	// Create the texture.
+	if (FAILED(direct3D->GetDevice()->CreateTexture2D(&texture_desc, &initial_data, &texture_)))
+		return false;
+
+	// Create the shader resource view for the texture.
+	if (FAILED(direct3D->GetDevice()->CreateShaderResourceView(texture_, 0, &texture_view_)))
+		return false;
+
+	return true;
+}
+
+void TextureAtlas::Shutdown()
+{
+	if (texture_view_)
+	{
+		texture_view_->Release();
+		texture_view_ = 0;
+	}
+
+	if (texture_)
+	{
+		texture_->Release();
+		texture_ = 0;
+	}
+
+	skyline_.clear();
+}
+
+bool TextureAtlas::Insert(Direct3D* direct3D, unsigned int width, unsigned int height, const unsigned char* pixels, unsigned int pitch, AtlasRegion& region)
+{
+	// Reserve the padding on the right and bottom; the left and top are covered by the neighbour's padding or the edge.
+	unsigned int x = 0, y = 0;
+	size_t node = 0;
+	if (!FindPosition(width + ATLAS_PADDING, height + ATLAS_PADDING, x, y, node))
+		return false;
+
+	AddSkylineLevel(node, x, y, width + ATLAS_PADDING, height + ATLAS_PADDING);
+
+	region.x = x;
+	region.y = y;
+	region.width = width;
+	region.height = height;
+	region.uv = XMFLOAT4(static_cast<float>(x) / width_, static_cast<float>(y) / height_,
+		static_cast<float>(x + width) / width_, static_cast<float>(y + height) / height_);
+
+	// Copy the image into its place.
+	if (width > 0 && height > 0)
+	{
+		D3D11_BOX box = { x, y, 0, x + width, y + height, 1 };
+		direct3D->GetDeviceContext()->UpdateSubresource(texture_, 0, &box, pixels, pitch, 0);
+	}
+
+	return true;
+}
+
+ID3D11ShaderResourceView* TextureAtlas::GetTexture()
+{
+	return texture_view_;
+}
+
+unsigned int TextureAtlas::GetWidth()
+{
+	return width_;
+}
+
+unsigned int TextureAtlas::GetHeight()
+{
+	return height_;
+}
+
+bool TextureAtlas::FindPosition(unsigned int width, unsigned int height, unsigned int& best_x, unsigned int& best_y, size_t& best_node)
+{
+	// Try the rectangle's left edge at the start of each run. It rests on the highest run it spans; keep the placement
+	// whose bottom is lowest, then the one resting on the narrowest run, which wastes the least space.
+	unsigned int best_bottom = ~0u, best_width = ~0u;
+	bool found = false;
+
+	for (size_t i = 0; i < skyline_.size(); i++)
+	{
+		unsigned int x = skyline_[i].x;
+		if (x + width > width_)
+			break;
+
+		unsigned int y = 0;
+		unsigned int remaining = width;
+		for (size_t j = i; remaining > 0; j++)
+		{
+			y = (std::max)(y, skyline_[j].y);
+			remaining -= (std::min)(remaining, skyline_[j].width);
+		}
+
+		if (y + height > height_)
+			continue;
+
+		unsigned int bottom = y + height;
+		if (bottom < best_bottom || (bottom == best_bottom && skyline_[i].width < best_width))
+		{
+			best_bottom = bottom;
+			best_width = skyline_[i].width;
+			best_x = x;
+			best_y = y;
+			best_node = i;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+void TextureAtlas::AddSkylineLevel(size_t index, unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+{
+	// The new run covers the rectangle's top...
+	SkylineNode node = { x, y + height, width };
+	skyline_.insert(skyline_.begin() + index, node);
+
+	// ...and hides the runs, or the parts of them, beneath it.
+	size_t next = index + 1;
+	while (next < skyline_.size())
+	{
+		SkylineNode& covered = skyline_[next];
+		unsigned int right = x + width;
+		if (covered.x >= right)
+			break;
+
+		unsigned int shrink = (std::min)(right - covered.x, covered.width);
+		covered.x += shrink;
+		covered.width -= shrink;
+		if (covered.width > 0)
+			break;
+
+		skyline_.erase(skyline_.begin() + next);
+	}
+
+	// Merge neighbouring runs at the same height.
+	for (size_t i = 0; i + 1 < skyline_.size();)
+	{
+		if (skyline_[i].y == skyline_[i + 1].y)
+		{
+			skyline_[i].width += skyline_[i + 1].width;
+			skyline_.erase(skyline_.begin() + i + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
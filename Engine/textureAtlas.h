@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <d3d11.h>
+#include <DirectXMath.h>
+using namespace DirectX;
+
+class Direct3D;
+
+// Empty texels left around every image so bilinear filtering never reads a neighbour.
+const unsigned int ATLAS_PADDING = 1;
+
+// Where an image was placed in an atlas, in texels and as texture coordinates (left, top, right, bottom).
+struct AtlasRegion
+{
+	unsigned int x, y, width, height;
+	XMFLOAT4 uv;
+};
+
+class TextureAtlas
+{
+public:
+	TextureAtlas();
+	TextureAtlas(const TextureAtlas&);
+	~TextureAtlas();
+
+	// Create an empty RGBA texture of the given size.
+	bool Initialize(Direct3D*, unsigned int, unsigned int);
+	void Shutdown();
+
+	// Pack an RGBA image (width, height, pixels, row pitch in bytes) into free space and upload it.
+	// Returns false when the atlas has no room left.
+	bool Insert(Direct3D*, unsigned int, unsigned int, const unsigned char*, unsigned int, AtlasRegion&);
+
+	ID3D11ShaderResourceView* GetTexture();
+	unsigned int GetWidth();
+	unsigned int GetHeight();
+
+private:
+	// The top edge of the packed area, as runs of equal height from left to right.
+	struct SkylineNode
+	{
+		unsigned int x, y, width;
+	};
+
+	bool FindPosition(unsigned int, unsigned int, unsigned int&, unsigned int&, size_t&);
+	void AddSkylineLevel(size_t, unsigned int, unsigned int, unsigned int, unsigned int);
+
+private:
+	unsigned int width_;
+	unsigned int height_;
+	std::vector<SkylineNode> skyline_;
+	ID3D11Texture2D* texture_;
+	ID3D11ShaderResourceView* texture_view_;
+};